@@ -0,0 +1,48 @@
+#include <stdio.h>            // printf
+#include "fcl_allocator.h"
+#include "fcl_list.h"
+
+struct my_node {
+  int id;
+  int priority;
+  struct fcl_list_links links;
+};
+
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_links, links,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_links, links,
+                        LIFO)
+
+static const char *backend_names[] = {
+  "aligned_alloc", "mmap", "mmap+thp", "mmap+hugetlb"
+};
+
+int main() {
+  struct node_allocator node_alloc;
+  struct my_node *entry;
+  fcl_allocator_backend backend;
+  unsigned flags;
+
+  for (backend = FCL_ALLOCATOR_BACKEND_ALIGNED_ALLOC;
+       backend <= FCL_ALLOCATOR_BACKEND_MMAP_HUGETLB; backend++) {
+    flags = FCL_ALLOCATOR_SLAB_PREFAULT | FCL_ALLOCATOR_SLAB_MLOCK;
+    if (node_allocator_init_backend(&node_alloc, 100000,
+                                    FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0, NULL,
+                                    backend, flags) != 1) {
+      printf("%s: init failed\n", backend_names[backend]);
+      continue;
+    }
+    // report what was actually obtained
+    printf("requested %s: got %s, prefault: %s, mlock: %s\n",
+           backend_names[backend], backend_names[node_alloc.backend],
+           node_alloc.slab_flags & FCL_ALLOCATOR_SLAB_PREFAULT ? "yes" : "no",
+           node_alloc.slab_flags & FCL_ALLOCATOR_SLAB_MLOCK ? "yes" : "no");
+
+    entry = node_allocator_borrow(&node_alloc);
+    entry->id = 1;
+    node_allocator_return(&node_alloc, entry);
+    node_allocator_freeall(&node_alloc);
+  }
+
+  return 0;
+}
@@ -1,100 +1,309 @@
-#include <stdio.h>            // printf
-#include <sys/time.h>         // gettimeofday
+#include <pthread.h>          // pthread_create
+#include <sched.h>            // sched_yield
+#include <stdio.h>            // fprintf
+#include <stdlib.h>           // malloc
 #include "fcl_allocator.h"
+#include "fcl_allocator_tc.h"
 #include "fcl_list.h"
+#include "fcl_list_atomic.h"
+#include "fcl_bench.h"
+
+#define DEFAULT_SIZE 100000
+#define RECYCLE_BATCH 16
+#define NUM_PRODUCERS 3
 
 struct my_node {
   int id;
   int priority;
-  struct fcl_list_links links;
+  struct fcl_list_link link;
+  char payload[48];
 };
 
-// declare the structs and functions for the my_node allocator
-FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_links, links,
+// the same node type behind a LIFO and a FIFO recycling allocator
+FCL_ALLOCATOR_LL_DECLARE(lnode, struct my_node, struct fcl_list_link, link,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(lnode, struct my_node, struct fcl_list_link, link,
                         LIFO)
+FCL_ALLOCATOR_LL_DECLARE(fnode, struct my_node, struct fcl_list_link, link,
+                         FIFO)
+FCL_ALLOCATOR_LL_DEFINE(fnode, struct my_node, struct fcl_list_link, link,
+                        FIFO)
 
-// generate the functions for the my_node allocator
-FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_links, links,
+// a thread cached allocator and a queue for the producer/consumer workload
+FCL_ALLOCATOR_LL_DECLARE(tnode, struct my_node, struct fcl_list_link, link,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(tnode, struct my_node, struct fcl_list_link, link,
                         LIFO)
+FCL_ALLOCATOR_TC_DECLARE(tnode, struct my_node, struct fcl_list_link, link)
+FCL_ALLOCATOR_TC_DEFINE(tnode, struct my_node, struct fcl_list_link, link)
+FCL_LIST_MPSC_DECLARE(queue, struct my_node, struct fcl_list_link, link)
+FCL_LIST_MPSC_DEFINE(queue, struct my_node, struct fcl_list_link, link)
 
-FCL_LIST_DL_DEFINE(node, struct my_node, links)
+struct ctx {
+  size_t n;
+  struct my_node **nodes;
+  size_t *order;
+  struct lnode_allocator lalloc;
+  struct fnode_allocator falloc;
+  struct tnode_depot depot;
+  struct queue_mpsc_head queue;
+  int use_malloc;
+};
 
 // function declarations
-double delta_seconds(struct timeval *s, struct timeval *e);
 void my_node_init(struct my_node *n);
+void touch(struct my_node *n);
+void churn_fcl(void *arg);
+void churn_malloc(void *arg);
+void random_return_setup_fcl(void *arg);
+void random_return_fcl(void *arg);
+void random_return_setup_malloc(void *arg);
+void random_return_malloc(void *arg);
+void burst_growth_fcl(void *arg);
+void burst_growth_malloc(void *arg);
+void recycle_lifo(void *arg);
+void recycle_fifo(void *arg);
+void recycle_malloc(void *arg);
+void *producer(void *arg);
+void *consumer(void *arg);
+void prodcons(void *arg);
 
-int main() {
-  struct node_allocator node_alloc;
-  int i, num_nodes;
-  num_nodes = 100000;
-  struct fcl_list_links head;
-  struct timeval start, end;
-  struct my_node *entry;
-  struct fcl_list_links *iter, *tmp;
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  struct ctx *c;
+  size_t i;
+  uint64_t seed = 42;
 
+  fcl_bench_init(&b, argc, argv, DEFAULT_SIZE);
+  c = calloc(1, sizeof(*c));
+  if (!c || !b.size)
+    return 1;
+  c->n = b.size;
+  c->nodes = malloc(sizeof(*c->nodes) * c->n);
+  c->order = malloc(sizeof(*c->order) * c->n);
+  if (!c->nodes || !c->order)
+    return 1;
+  for (i=0; i < c->n; i++)
+    c->order[i] = fcl_bench_rand(&seed) % c->n;
 
-  gettimeofday(&start, NULL);
-  node_allocator_init(&node_alloc, num_nodes, FCL_ALLOCATOR_OOM_POLICY_DOUBLE,
-                      0, my_node_init);
-  fcl_list_dl_init(&head);
+  // steady state: n live objects, each op returns one and borrows another
+  lnode_allocator_init(&c->lalloc, c->n, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                       my_node_init);
+  for (i=0; i < c->n; i++)
+    c->nodes[i] = lnode_allocator_borrow(&c->lalloc);
+  fcl_bench_run(&b, "churn_fcl", c->n, NULL, churn_fcl, c);
+  for (i=0; i < c->n; i++)
+    lnode_allocator_return(&c->lalloc, c->nodes[i]);
+  for (i=0; i < c->n; i++)
+    c->nodes[i] = malloc(sizeof(struct my_node));
+  fcl_bench_run(&b, "churn_malloc", c->n, NULL, churn_malloc, c);
+  for (i=0; i < c->n; i++)
+    free(c->nodes[i]);
 
-  for (i=0; i < num_nodes; i++)
-    node_list_insert_tail(&head, node_allocator_borrow(&node_alloc));
+  // n objects returned in random order
+  fcl_bench_run(&b, "random_return_fcl", c->n, random_return_setup_fcl,
+                random_return_fcl, c);
+  fcl_bench_run(&b, "random_return_malloc", c->n, random_return_setup_malloc,
+                random_return_malloc, c);
 
-  FCL_LIST_DL_EACH(&head, iter, tmp) {
-    entry = node_list_get_entry(iter);
-    node_list_remove(entry);
-    node_allocator_return(&node_alloc, entry);
-  }
+  // a fresh allocator grows from a small pool to n objects
+  fcl_bench_run(&b, "burst_growth_fcl", c->n, NULL, burst_growth_fcl, c);
+  fcl_bench_run(&b, "burst_growth_malloc", c->n, NULL, burst_growth_malloc, c);
+
+  // small batches borrowed, written and returned with n objects free;
+  // LIFO keeps reusing the same warm objects, FIFO cycles through all n
+  fnode_allocator_init(&c->falloc, c->n, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                       my_node_init);
+  fnode_allocator_borrow_bulk(&c->falloc, c->nodes, c->n);
+  for (i=0; i < c->n; i++)
+    fnode_allocator_return(&c->falloc, c->nodes[i]);
+  fcl_bench_run(&b, "recycle_lifo", c->n, NULL, recycle_lifo, c);
+  fcl_bench_run(&b, "recycle_fifo", c->n, NULL, recycle_fifo, c);
+  fcl_bench_run(&b, "recycle_malloc", c->n, NULL, recycle_malloc, c);
+  fnode_allocator_freeall(&c->falloc);
+  lnode_allocator_freeall(&c->lalloc);
+
+  // producers borrow and enqueue, one consumer dequeues and returns
+  tnode_depot_init(&c->depot, c->n / 4, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                   my_node_init, 0);
+  queue_mpsc_head_init(&c->queue);
+  c->use_malloc = 0;
+  fcl_bench_run(&b, "prodcons_fcl", c->n, NULL, prodcons, c);
+  c->use_malloc = 1;
+  fcl_bench_run(&b, "prodcons_malloc", c->n, NULL, prodcons, c);
+  tnode_depot_freeall(&c->depot);
 
-  node_allocator_freeall(&node_alloc);
-  gettimeofday(&end, NULL);
+  fcl_bench_finish(&b);
+  free(c->order);
+  free(c->nodes);
+  free(c);
 
-  printf("node_allocator: %fs\n", delta_seconds(&start, &end));
+  return 0;
+}
+
+void my_node_init(struct my_node *n) {
+  n->id = -1;
+  n->priority = -1;
+}
 
+void touch(struct my_node *n) {
+  memset(n->payload, n->id, sizeof(n->payload));
+}
 
-  gettimeofday(&start, NULL);
-  fcl_list_dl_init(&head);
-  for (i=0; i < num_nodes; i++) {
-    entry = malloc(sizeof(*entry));
-    if (!entry)
-      continue;
-    node_list_insert_tail(&head, entry);
+void churn_fcl(void *arg) {
+  struct ctx *c = arg;
+  size_t i, j;
+  for (i=0; i < c->n; i++) {
+    j = c->order[i];
+    lnode_allocator_return(&c->lalloc, c->nodes[j]);
+    c->nodes[j] = lnode_allocator_borrow(&c->lalloc);
+    c->nodes[j]->id = i;
   }
+}
 
-  FCL_LIST_DL_EACH(&head, iter, tmp) {
-    entry = node_list_get_entry(iter);
-    node_list_remove(entry);
-    free(entry);
+void churn_malloc(void *arg) {
+  struct ctx *c = arg;
+  size_t i, j;
+  for (i=0; i < c->n; i++) {
+    j = c->order[i];
+    free(c->nodes[j]);
+    c->nodes[j] = malloc(sizeof(struct my_node));
+    c->nodes[j]->id = i;
   }
-  gettimeofday(&end, NULL);
+}
 
-  printf("malloc/free: %fs\n", delta_seconds(&start, &end));
+void random_return_setup_fcl(void *arg) {
+  struct ctx *c = arg;
+  lnode_allocator_borrow_bulk(&c->lalloc, c->nodes, c->n);
+  fcl_bench_shuffle(c->nodes, c->n, sizeof(*c->nodes), c->n);
+}
 
-  return 0;
+void random_return_fcl(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  for (i=0; i < c->n; i++)
+    lnode_allocator_return(&c->lalloc, c->nodes[i]);
 }
 
-void my_node_init(struct my_node *n) {
-  n->id = -1;
-  n->priority = -1;
+void random_return_setup_malloc(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  for (i=0; i < c->n; i++)
+    c->nodes[i] = malloc(sizeof(struct my_node));
+  fcl_bench_shuffle(c->nodes, c->n, sizeof(*c->nodes), c->n);
 }
 
-double delta_seconds(struct timeval *s, struct timeval *e) {
-  double d;
+void random_return_malloc(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  for (i=0; i < c->n; i++)
+    free(c->nodes[i]);
+}
+
+void burst_growth_fcl(void *arg) {
+  struct ctx *c = arg;
+  struct lnode_allocator a;
+  size_t i;
+  lnode_allocator_init(&a, 64, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                       my_node_init);
+  for (i=0; i < c->n; i++)
+    c->nodes[i] = lnode_allocator_borrow(&a);
+  lnode_allocator_freeall(&a);
+}
 
-  if (e->tv_sec < s->tv_sec) {
-    return 0.0;
-  } else {
-    d = e->tv_sec - s->tv_sec;
+void burst_growth_malloc(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  for (i=0; i < c->n; i++)
+    c->nodes[i] = malloc(sizeof(struct my_node));
+  for (i=0; i < c->n; i++)
+    free(c->nodes[i]);
+}
+
+void recycle_lifo(void *arg) {
+  struct ctx *c = arg;
+  struct my_node *batch[RECYCLE_BATCH];
+  size_t i, j;
+  for (i=0; i < c->n; i += RECYCLE_BATCH) {
+    for (j=0; j < RECYCLE_BATCH; j++) {
+      batch[j] = lnode_allocator_borrow(&c->lalloc);
+      touch(batch[j]);
+    }
+    for (j=0; j < RECYCLE_BATCH; j++)
+      lnode_allocator_return(&c->lalloc, batch[j]);
   }
+}
 
-  if (e->tv_usec > s->tv_usec) {
-    d+= (e->tv_usec - s->tv_usec) / 1000000.0;
-  } else {
-    d--;
-    d+= (1000000 - s->tv_usec + e->tv_usec) / 1000000.0;
+void recycle_fifo(void *arg) {
+  struct ctx *c = arg;
+  struct my_node *batch[RECYCLE_BATCH];
+  size_t i, j;
+  for (i=0; i < c->n; i += RECYCLE_BATCH) {
+    for (j=0; j < RECYCLE_BATCH; j++) {
+      batch[j] = fnode_allocator_borrow(&c->falloc);
+      touch(batch[j]);
+    }
+    for (j=0; j < RECYCLE_BATCH; j++)
+      fnode_allocator_return(&c->falloc, batch[j]);
   }
+}
 
-  return d;
+void recycle_malloc(void *arg) {
+  struct ctx *c = arg;
+  struct my_node *batch[RECYCLE_BATCH];
+  size_t i, j;
+  for (i=0; i < c->n; i += RECYCLE_BATCH) {
+    for (j=0; j < RECYCLE_BATCH; j++) {
+      batch[j] = malloc(sizeof(struct my_node));
+      batch[j]->id = j;
+      touch(batch[j]);
+    }
+    for (j=0; j < RECYCLE_BATCH; j++)
+      free(batch[j]);
+  }
+}
+
+void *producer(void *arg) {
+  struct ctx *c = arg;
+  struct tnode_tcache tc;
+  struct my_node *e;
+  size_t i;
+  tnode_tcache_init(&tc, &c->depot);
+  for (i=0; i < c->n / NUM_PRODUCERS; i++) {
+    e = c->use_malloc ? malloc(sizeof(*e)) : tnode_tcache_borrow(&tc);
+    if (!e)
+      break;
+    e->id = i;
+    queue_mpsc_push(&c->queue, e);
+  }
+  tnode_tcache_flush(&tc);
+  return NULL;
 }
 
+void *consumer(void *arg) {
+  struct ctx *c = arg;
+  struct tnode_tcache tc;
+  struct my_node *e;
+  size_t n;
+  tnode_tcache_init(&tc, &c->depot);
+  for (n = (c->n / NUM_PRODUCERS) * NUM_PRODUCERS; n > 0; n--) {
+    while (!(e = queue_mpsc_pop(&c->queue)))
+      sched_yield();
+    if (c->use_malloc)
+      free(e);
+    else
+      tnode_tcache_return(&tc, e);
+  }
+  tnode_tcache_flush(&tc);
+  return NULL;
+}
+
+void prodcons(void *arg) {
+  pthread_t threads[NUM_PRODUCERS + 1];
+  int i;
+  pthread_create(&threads[NUM_PRODUCERS], NULL, consumer, arg);
+  for (i=0; i < NUM_PRODUCERS; i++)
+    pthread_create(&threads[i], NULL, producer, arg);
+  for (i=0; i <= NUM_PRODUCERS; i++)
+    pthread_join(threads[i], NULL);
+}
@@ -0,0 +1,114 @@
+#include <stdint.h>           // uint64_t
+#include <stdio.h>            // snprintf
+#include <string.h>           // memset
+#include "fcl_allocator.h"
+#include "fcl_bench.h"
+
+#define DEFAULT_SIZE 16384
+#define BATCH 64
+#define PAYLOAD 1000
+
+// a large object whose next user only writes the header
+struct big {
+  uint64_t id;
+  uint32_t state;
+  struct fcl_list_link link;
+  char payload[PAYLOAD];
+};
+
+FCL_ALLOCATOR_LL_DECLARE(big, struct big, struct fcl_list_link, link, LIFO)
+FCL_ALLOCATOR_LL_DEFINE(big, struct big, struct fcl_list_link, link, LIFO)
+
+struct ctx {
+  size_t n;
+  uint64_t sink;
+  struct big_allocator a;
+  struct big **objs;
+};
+
+static const struct {
+  const char *name;
+  fcl_allocator_init_policy policy;
+} policies[] = {
+  {"on_return", FCL_ALLOCATOR_INIT_POLICY_ON_RETURN},
+  {"on_borrow", FCL_ALLOCATOR_INIT_POLICY_ON_BORROW},
+  {"none", FCL_ALLOCATOR_INIT_POLICY_NONE},
+  {"prototype", FCL_ALLOCATOR_INIT_POLICY_PROTOTYPE},
+  {"deferred", FCL_ALLOCATOR_INIT_POLICY_DEFERRED}
+};
+
+static struct big prototype;
+
+// function declarations
+void big_init(struct big *e);
+void borrow_all(void *arg);
+void return_all(void *arg);
+void pair(void *arg);
+
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  static struct ctx c;
+  char name[64];
+  size_t p;
+
+  fcl_bench_init(&b, argc, argv, DEFAULT_SIZE);
+  c.n = b.size;
+  c.sink = 0;
+  c.objs = malloc(sizeof(*c.objs) * c.n);
+  if (!c.objs || big_allocator_init(&c.a, c.n, FCL_ALLOCATOR_OOM_POLICY_ERROR,
+                                    0, big_init) != 1)
+    return 1;
+  big_init(&prototype);
+
+  for (p=0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+    big_allocator_set_init_policy(&c.a, policies[p].policy, &prototype);
+    // return: n objects borrowed untimed, then returned one at a time; the
+    // untimed setup is also the idle time in which DEFERRED reinitializes
+    snprintf(name, sizeof(name), "return_%s", policies[p].name);
+    fcl_bench_run(&b, name, c.n, borrow_all, return_all, &c);
+    // pair: borrow BATCH objects, write their headers, return them
+    snprintf(name, sizeof(name), "pair_%s", policies[p].name);
+    fcl_bench_run(&b, name, c.n / BATCH * BATCH, NULL, pair, &c);
+  }
+  fcl_bench_finish(&b);
+
+  big_allocator_freeall(&c.a);
+  free(c.objs);
+
+  return c.sink ? 0 : 1;
+}
+
+void big_init(struct big *e) {
+  e->id = 0;
+  e->state = 1;
+  memset(e->payload, 0, sizeof(e->payload));
+}
+
+void borrow_all(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  big_allocator_reinit(&c->a, SIZE_MAX);
+  for (i=0; i < c->n; i++)
+    c->objs[i] = big_allocator_borrow(&c->a);
+}
+
+void return_all(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  for (i=0; i < c->n; i++)
+    big_allocator_return(&c->a, c->objs[i]);
+}
+
+void pair(void *arg) {
+  struct ctx *c = arg;
+  size_t i, j;
+  for (i=0; i + BATCH <= c->n; i += BATCH) {
+    for (j=0; j < BATCH; j++) {
+      c->objs[j] = big_allocator_borrow(&c->a);
+      c->objs[j]->id = i + j;
+      c->sink += c->objs[j]->state;
+    }
+    for (j=0; j < BATCH; j++)
+      big_allocator_return(&c->a, c->objs[j]);
+  }
+}
@@ -0,0 +1,103 @@
+#include <stdint.h>           // uint64_t
+#include "fcl_allocator_policy_bench.h"
+#include "fcl_bench.h"
+
+#define DEFAULT_SIZE 1000000
+#define BATCH 64
+
+// the same allocator generated static inline in this translation unit, with
+// the oom policy read at runtime, fixed to DOUBLE, and fixed to ERROR
+FCL_ALLOCATOR_LL_DEFINE_STATIC(st_rt_node, struct my_node,
+                               struct fcl_list_link, link, LIFO, RUNTIME)
+FCL_ALLOCATOR_LL_DEFINE_STATIC(st_fx_node, struct my_node,
+                               struct fcl_list_link, link, LIFO, DOUBLE)
+FCL_ALLOCATOR_LL_DEFINE_STATIC(st_err_node, struct my_node,
+                               struct fcl_list_link, link, LIFO, ERROR)
+
+struct ctx {
+  size_t n;
+  uint64_t sink;
+  struct my_node *batch[BATCH];
+  struct rt_node_allocator rt;
+  struct fx_node_allocator fx;
+  struct st_rt_node_allocator st_rt;
+  struct st_fx_node_allocator st_fx;
+  struct st_err_node_allocator st_err;
+};
+
+// pair: borrow one object, touch it, and return it, n times
+// batch: borrow BATCH objects, then return them all, n / BATCH times
+#define BENCH_VARIANT(v)  \
+void pair_##v(void *arg) {  \
+  struct ctx *c = arg;  \
+  struct my_node *e;  \
+  size_t i; \
+  for (i=0; i < c->n; i++) {  \
+    e = v##_node_allocator_borrow(&c->v); \
+    e->id = i;  \
+    c->sink += e->id; \
+    v##_node_allocator_return(&c->v, e); \
+  } \
+} \
+void batch_##v(void *arg) { \
+  struct ctx *c = arg;  \
+  size_t i, j;  \
+  for (i=0; i + BATCH <= c->n; i += BATCH) {  \
+    for (j=0; j < BATCH; j++) { \
+      c->batch[j] = v##_node_allocator_borrow(&c->v); \
+      c->batch[j]->id = j;  \
+    } \
+    for (j=0; j < BATCH; j++) { \
+      c->sink += c->batch[j]->id; \
+      v##_node_allocator_return(&c->v, c->batch[j]);  \
+    } \
+  } \
+}
+
+BENCH_VARIANT(rt)
+BENCH_VARIANT(fx)
+BENCH_VARIANT(st_rt)
+BENCH_VARIANT(st_fx)
+BENCH_VARIANT(st_err)
+
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  static struct ctx c;
+
+  fcl_bench_init(&b, argc, argv, DEFAULT_SIZE);
+  c.n = b.size;
+  if (rt_node_allocator_init(&c.rt, BATCH, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                             NULL) != 1 ||
+      fx_node_allocator_init(&c.fx, BATCH, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                             NULL) != 1 ||
+      st_rt_node_allocator_init(&c.st_rt, BATCH,
+                                FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                                NULL) != 1 ||
+      st_fx_node_allocator_init(&c.st_fx, BATCH,
+                                FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                                NULL) != 1 ||
+      st_err_node_allocator_init(&c.st_err, BATCH,
+                                 FCL_ALLOCATOR_OOM_POLICY_ERROR, 0,
+                                 NULL) != 1)
+    return 1;
+
+  fcl_bench_run(&b, "pair_extern_runtime", c.n, NULL, pair_rt, &c);
+  fcl_bench_run(&b, "pair_extern_fixed", c.n, NULL, pair_fx, &c);
+  fcl_bench_run(&b, "pair_static_runtime", c.n, NULL, pair_st_rt, &c);
+  fcl_bench_run(&b, "pair_static_fixed", c.n, NULL, pair_st_fx, &c);
+  fcl_bench_run(&b, "pair_static_error", c.n, NULL, pair_st_err, &c);
+  fcl_bench_run(&b, "batch_extern_runtime", c.n, NULL, batch_rt, &c);
+  fcl_bench_run(&b, "batch_extern_fixed", c.n, NULL, batch_fx, &c);
+  fcl_bench_run(&b, "batch_static_runtime", c.n, NULL, batch_st_rt, &c);
+  fcl_bench_run(&b, "batch_static_fixed", c.n, NULL, batch_st_fx, &c);
+  fcl_bench_run(&b, "batch_static_error", c.n, NULL, batch_st_err, &c);
+  fcl_bench_finish(&b);
+
+  rt_node_allocator_freeall(&c.rt);
+  fx_node_allocator_freeall(&c.fx);
+  st_rt_node_allocator_freeall(&c.st_rt);
+  st_fx_node_allocator_freeall(&c.st_fx);
+  st_err_node_allocator_freeall(&c.st_err);
+
+  return c.sink ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#ifndef _FCL_ALLOCATOR_POLICY_BENCH_H_
+#define _FCL_ALLOCATOR_POLICY_BENCH_H_
+
+#include <stdint.h>           // uint64_t
+#include "fcl_allocator.h"
+
+struct my_node {
+  uint64_t id;
+  struct fcl_list_link link;
+};
+
+// defined in fcl_allocator_policy_ext.c, so every call from the benchmark
+// is a real call into another translation unit
+FCL_ALLOCATOR_LL_DECLARE(rt_node, struct my_node, struct fcl_list_link, link,
+                         LIFO)
+FCL_ALLOCATOR_LL_POLICY_DECLARE(fx_node, struct my_node, struct fcl_list_link,
+                                link, LIFO, DOUBLE)
+
+#endif  // _FCL_ALLOCATOR_POLICY_BENCH_H_
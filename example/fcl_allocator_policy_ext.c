@@ -0,0 +1,6 @@
+#include "fcl_allocator_policy_bench.h"
+
+FCL_ALLOCATOR_LL_DEFINE(rt_node, struct my_node, struct fcl_list_link, link,
+                        LIFO)
+FCL_ALLOCATOR_LL_POLICY_DEFINE(fx_node, struct my_node, struct fcl_list_link,
+                               link, LIFO, DOUBLE)
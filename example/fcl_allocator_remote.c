@@ -0,0 +1,104 @@
+#include <stdio.h>            // printf
+#include <pthread.h>          // pthread_create
+#include <sched.h>            // sched_yield
+#include <stdatomic.h>        // atomic_int
+#include "fcl_allocator.h"
+#include "fcl_list_atomic.h"
+
+#define NUM_WORKERS 3
+#define POOL_SIZE 256
+#define NUM_ROUNDS 1000000
+
+struct my_node {
+  long id;
+  struct fcl_list_link link;    // allocator free lists
+  struct fcl_list_link qlink;   // work queue, while borrowed
+};
+
+// the ingest thread owns the allocator, workers give nodes back remotely
+FCL_ALLOCATOR_LL_REMOTE_DECLARE(node, struct my_node, struct fcl_list_link,
+                                link, LIFO)
+FCL_ALLOCATOR_LL_REMOTE_DEFINE(node, struct my_node, struct fcl_list_link,
+                               link, LIFO)
+
+FCL_LIST_MPSC_DECLARE(work, struct my_node, struct fcl_list_link, qlink)
+FCL_LIST_MPSC_DEFINE(work, struct my_node, struct fcl_list_link, qlink)
+
+struct worker {
+  pthread_t thread;
+  struct work_mpsc_head queue;
+  long sum;
+};
+
+struct node_allocator node_alloc;
+struct worker workers[NUM_WORKERS];
+atomic_int done;
+
+// function declarations
+void *worker(void *arg);
+
+int main() {
+  struct my_node *e;
+  long i, sum, expected;
+  size_t waits = 0;
+  int w;
+
+  // a fixed pool far smaller than the number of rounds: the ingest thread
+  // only keeps going because borrow reclaims the remote frees
+  if (node_allocator_init(&node_alloc, POOL_SIZE,
+                          FCL_ALLOCATOR_OOM_POLICY_ERROR, 0, NULL) != 1)
+    return 1;
+  atomic_init(&done, 0);
+  for (w=0; w < NUM_WORKERS; w++) {
+    work_mpsc_head_init(&workers[w].queue);
+    workers[w].sum = 0;
+    pthread_create(&workers[w].thread, NULL, worker, &workers[w]);
+  }
+
+  expected = 0;
+  for (i=0; i < NUM_ROUNDS; i++) {
+    while (!(e = node_allocator_borrow(&node_alloc))) {
+      waits++;
+      sched_yield();
+    }
+    e->id = i;
+    expected += i;
+    work_mpsc_push(&workers[i % NUM_WORKERS].queue, e);
+  }
+  atomic_store(&done, 1);
+
+  sum = 0;
+  for (w=0; w < NUM_WORKERS; w++) {
+    pthread_join(workers[w].thread, NULL);
+    sum += workers[w].sum;
+  }
+  node_allocator_reclaim(&node_alloc);
+
+  printf("rounds: %d, pool: %zu, free: %zu, empty pool waits: %zu\n",
+         NUM_ROUNDS, node_alloc.total_count, node_alloc.free_count, waits);
+  printf("sum: %ld, expected: %ld\n", sum, expected);
+  if (sum != expected || node_alloc.total_count != POOL_SIZE ||
+      node_alloc.free_count != POOL_SIZE)
+    return 1;
+  node_allocator_freeall(&node_alloc);
+
+  return 0;
+}
+
+void *worker(void *arg) {
+  struct worker *self = arg;
+  struct my_node *e;
+  int finished;
+
+  for (;;) {
+    finished = atomic_load(&done);
+    while ((e = work_mpsc_pop(&self->queue))) {
+      self->sum += e->id;
+      node_allocator_return_remote(&node_alloc, e);
+    }
+    if (finished)
+      break;
+    sched_yield();
+  }
+  return NULL;
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>            // printf
+
+// enable the allocator counters and print every growth event
+#define FCL_ALLOCATOR_STATS
+#define FCL_ALLOCATOR_TRACE_GROW(a, count, ns, ok) \
+  printf("grow: %zu objects, %llu ns, %s\n", (size_t)(count), \
+         (unsigned long long)(ns), (ok) ? "ok" : "failed")
+
+#include "fcl_allocator.h"
+#include "fcl_list.h"
+
+#define NUM_BURSTS 4
+#define CARVE_SLAB 16
+
+struct my_node {
+  int id;
+  int priority;
+  struct fcl_list_links links;
+};
+
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_links, links,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_links, links,
+                        LIFO)
+
+FCL_LIST_DL_DEFINE(node, struct my_node, links)
+
+// the number of times my_node_init ran
+size_t inits;
+
+// function declarations
+void my_node_init(struct my_node *n);
+int check_carving(void);
+
+int main() {
+  struct node_allocator node_alloc;
+  struct fcl_allocator_stats stats;
+  struct fcl_list_links head, *iter, *tmp;
+  struct my_node *entry;
+  int i, j, burst;
+
+  node_allocator_init(&node_alloc, 1024, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                      my_node_init);
+  fcl_list_dl_init(&head);
+  // the new slab is counted free, and nothing is initialized until carved
+  if (node_alloc.total_count < 1024 ||
+      node_alloc.free_count != node_alloc.total_count || inits)
+    return 1;
+
+  // bursts of growing size, each released before the next
+  for (i=0, burst=1000; i < NUM_BURSTS; i++, burst *= 4) {
+    for (j=0; j < burst; j++)
+      node_list_insert_tail(&head, node_allocator_borrow(&node_alloc));
+    FCL_LIST_DL_EACH(&head, iter, tmp) {
+      entry = node_list_get_entry(iter);
+      node_list_remove(entry);
+      node_allocator_return(&node_alloc, entry);
+    }
+  }
+
+  node_allocator_stats(&node_alloc, &stats);
+  printf("borrows: %llu, failed borrows: %llu, returns: %llu\n",
+         (unsigned long long)stats.borrows,
+         (unsigned long long)stats.failed_borrows,
+         (unsigned long long)stats.returns);
+  printf("grows: %llu, failed grows: %llu, grow time: %llu ns\n",
+         (unsigned long long)stats.grows,
+         (unsigned long long)stats.failed_grows,
+         (unsigned long long)stats.grow_ns);
+  printf("in use: %zu, in use hwm: %zu, free: %zu, total: %zu\n",
+         stats.in_use, stats.in_use_hwm, stats.free, stats.total);
+  for (i=0; i < FCL_ALLOCATOR_STATS_HIST_BUCKETS; i++)
+    if (stats.grow_hist[i])
+      printf("grow latency [%llu, %llu) ns: %llu\n", 1ull << i,
+             2ull << i, (unsigned long long)stats.grow_hist[i]);
+
+  node_allocator_freeall(&node_alloc);
+
+  return check_carving();
+}
+
+void my_node_init(struct my_node *n) {
+  n->id = -1;
+  n->priority = -1;
+  inits++;
+}
+
+// borrows across a growth that leaves part of the first slab uncarved, and
+// checks every object is initialized once, when it is carved
+int check_carving(void) {
+  struct node_allocator a;
+  struct my_node *e[2 * CARVE_SLAB];
+  size_t i, j, n = CARVE_SLAB - CARVE_SLAB / 4;
+
+  if (node_allocator_init(&a, CARVE_SLAB, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                          my_node_init) != 1)
+    return 1;
+  inits = 0;
+  for (i=0; i < n; i++)
+    e[i] = node_allocator_borrow(&a);
+  if (inits != n || a.free_count != a.total_count - n)
+    return 1;
+  // the rest of the first slab goes to the free list when the bulk borrow
+  // grows, so the batch takes it before carving from the new slab
+  if (node_allocator_borrow_bulk(&a, &e[n], 2 * CARVE_SLAB - n) !=
+      2 * CARVE_SLAB - n)
+    return 1;
+  printf("carving: %zu borrowed, %zu inits, %zu free of %zu\n",
+         (size_t)2 * CARVE_SLAB, inits, a.free_count, a.total_count);
+  if (inits != 2 * CARVE_SLAB || a.total_count != 2 * CARVE_SLAB ||
+      a.free_count)
+    return 1;
+  for (i=0; i < 2 * CARVE_SLAB; i++) {
+    if (e[i]->id != -1)
+      return 1;
+    e[i]->id = i;
+    for (j=0; j < i; j++)
+      if (e[j] == e[i])
+        return 1;
+  }
+  for (i=0; i < 2 * CARVE_SLAB; i++)
+    node_allocator_return(&a, e[i]);
+  if (a.free_count != a.total_count)
+    return 1;
+  node_allocator_freeall(&a);
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>            // printf
+#include <pthread.h>          // pthread_create
+#include "fcl_allocator_tc.h"
+#include "fcl_list.h"
+
+#define NUM_THREADS 4
+#define NUM_ROUNDS 1000
+#define BATCH 50
+
+struct my_node {
+  int id;
+  int priority;
+  struct fcl_list_links links;
+};
+
+// declare and generate the shared depot allocator and the thread caches
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_links, links,
+                         LIFO)
+FCL_ALLOCATOR_TC_DECLARE(node, struct my_node, struct fcl_list_links, links)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_links, links,
+                        LIFO)
+FCL_ALLOCATOR_TC_DEFINE(node, struct my_node, struct fcl_list_links, links)
+
+FCL_LIST_DL_DEFINE(node, struct my_node, links)
+
+// function declarations
+void my_node_init(struct my_node *n);
+void *worker(void *arg);
+
+struct node_depot depot;
+
+int main() {
+  pthread_t threads[NUM_THREADS];
+  struct node_tcache caches[NUM_THREADS];
+  int i;
+
+  if (node_depot_init(&depot, 1024, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                      my_node_init, 64) != 1)
+    return 1;
+
+  for (i=0; i < NUM_THREADS; i++) {
+    node_tcache_init(&caches[i], &depot);
+    pthread_create(&threads[i], NULL, worker, &caches[i]);
+  }
+
+  for (i=0; i < NUM_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    printf("thread %d: borrow hits: %zu misses: %zu, "
+           "return hits: %zu misses: %zu\n", i,
+           caches[i].borrow_hits, caches[i].borrow_misses,
+           caches[i].return_hits, caches[i].return_misses);
+  }
+  printf("depot: free: %zu total: %zu\n", depot.allocator.free_count,
+         depot.allocator.total_count);
+
+  node_depot_freeall(&depot);
+
+  return 0;
+}
+
+void *worker(void *arg) {
+  struct node_tcache *tc = arg;
+  struct fcl_list_links head, *iter, *tmp;
+  struct my_node *entry;
+  int i, j;
+
+  fcl_list_dl_init(&head);
+  for (i=0; i < NUM_ROUNDS; i++) {
+    for (j=0; j < BATCH; j++) {
+      entry = node_tcache_borrow(tc);
+      if (!entry)
+        break;
+      entry->id = j;
+      node_list_insert_tail(&head, entry);
+    }
+    FCL_LIST_DL_EACH(&head, iter, tmp) {
+      entry = node_list_get_entry(iter);
+      node_list_remove(entry);
+      node_tcache_return(tc, entry);
+    }
+  }
+  // hand the cached objects back before the thread exits
+  node_tcache_flush(tc);
+
+  return NULL;
+}
+
+void my_node_init(struct my_node *n) {
+  n->id = -1;
+  n->priority = -1;
+}
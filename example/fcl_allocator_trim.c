@@ -0,0 +1,111 @@
+#include <stdio.h>            // printf
+#include "fcl_allocator.h"
+#include "fcl_list.h"
+
+#define SLAB 64
+
+struct my_node {
+  int id;
+  struct fcl_list_link link;
+};
+
+// slabs of SLAB nodes each, so a burst leaves whole slabs free
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_link, link,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_link, link,
+                        LIFO)
+
+struct my_node *nodes[4 * SLAB];
+
+// function declarations
+int check(struct node_allocator *a, const char *what, size_t released,
+          size_t expect, size_t total, size_t nfree);
+int borrow(struct node_allocator *a, int from, int to);
+void give_back(struct node_allocator *a, int from, int to);
+
+int main() {
+  struct node_allocator alloc;
+  int err = 0;
+
+  if (node_allocator_init(&alloc, SLAB, FCL_ALLOCATOR_OOM_POLICY_INCREMENTAL,
+                          SLAB, NULL) != 1)
+    return 1;
+
+  // three slabs: the first and second in use, half of the third carved
+  if (borrow(&alloc, 0, 2 * SLAB + SLAB / 2) != 1 || alloc.num_slabs != 3)
+    return 1;
+
+  // a slab with one free node, or with part of it still to be carved and
+  // the rest in use, is not released
+  give_back(&alloc, 0, 1);
+  err |= check(&alloc, "partly free", node_allocator_trim(&alloc, 0), 0,
+               3 * SLAB, SLAB / 2 + 1);
+  if (borrow(&alloc, 0, 1) != 1)
+    return 1;
+
+  // the second and third slab become free, the third with its carve region
+  give_back(&alloc, SLAB, 2 * SLAB + SLAB / 2);
+  err |= check(&alloc, "keep 3/2 slabs",
+               node_allocator_trim(&alloc, SLAB + SLAB / 2), 0, 3 * SLAB,
+               2 * SLAB);
+  err |= check(&alloc, "keep 1 slab", node_allocator_trim(&alloc, SLAB),
+               SLAB, 2 * SLAB, SLAB);
+  err |= check(&alloc, "keep none", node_allocator_trim(&alloc, 0), SLAB,
+               SLAB, 0);
+  if (alloc.num_slabs != 1 || alloc.carve_next != alloc.carve_end) {
+    printf("the released carve region is still in use\n");
+    err = 1;
+  }
+
+  // the allocator grows again, past the released slabs
+  if (borrow(&alloc, SLAB, 4 * SLAB) != 1)
+    return 1;
+  err |= check(&alloc, "regrown", 0, 0, 4 * SLAB, 0);
+
+  // with nothing borrowed every slab goes, and the next borrow grows
+  give_back(&alloc, 0, 4 * SLAB);
+  err |= check(&alloc, "all free", node_allocator_trim(&alloc, 0), 4 * SLAB,
+               0, 0);
+  if (borrow(&alloc, 0, 1) != 1)
+    return 1;
+  err |= check(&alloc, "from empty", 0, 0, SLAB, SLAB - 1);
+  give_back(&alloc, 0, 1);
+
+  node_allocator_freeall(&alloc);
+
+  return err;
+}
+
+// checks trim released @expect nodes and left @total nodes, @nfree free
+int check(struct node_allocator *a, const char *what, size_t released,
+          size_t expect, size_t total, size_t nfree) {
+  printf("%s: released %zu, %zu free of %zu in %u slabs\n", what, released,
+         a->free_count, a->total_count, a->num_slabs);
+  if (released != expect || a->total_count != total || a->free_count != nfree)
+    return 1;
+  return 0;
+}
+
+// borrows nodes[from, to) and tags them, returns -1 if a node is handed out
+// twice
+int borrow(struct node_allocator *a, int from, int to) {
+  int i;
+
+  for (i=from; i < to; i++) {
+    nodes[i] = node_allocator_borrow(a);
+    if (!nodes[i])
+      return -1;
+    nodes[i]->id = i;
+  }
+  for (i=0; i < to; i++)
+    if (nodes[i]->id != i)
+      return -1;
+  return 1;
+}
+
+void give_back(struct node_allocator *a, int from, int to) {
+  int i;
+
+  for (i=from; i < to; i++)
+    node_allocator_return(a, nodes[i]);
+}
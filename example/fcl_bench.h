@@ -0,0 +1,337 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A minimal benchmark harness shared by the fcl benchmarks.
+
+   A benchmark is a function that performs a known number of operations per
+   call.  fcl_bench_run calls it for a number of warmup and measured
+   iterations, times every iteration, and reports the min, mean and
+   percentiles of the time per operation.  On Linux, hardware counters
+   (cycles, instructions, cache misses, branch misses) are read around every
+   iteration via perf_event_open when the kernel allows it, and reported per
+   operation.  Results are written as CSV (default) or JSON so runs can be
+   compared across versions.
+
+   Common command line options:
+     -i N   measured iterations (default 50)
+     -n N   problem size, interpreted by each benchmark
+     -f F   output format, csv or json
+     -o F   write results to file F instead of stdout
+     -b S   only run benchmarks whose name contains S
+     -h     print the options and exit
+   An unknown option, a missing value or an output file that cannot be
+   opened is reported on stderr and the benchmark exits with status 2.
+*/
+
+#ifndef _FCL_BENCH_H_
+#define _FCL_BENCH_H_
+
+#include <errno.h>      // errno
+#include <stdint.h>     // uint64_t
+#include <stdio.h>      // fprintf
+#include <stdlib.h>     // qsort
+#include <string.h>     // strcmp
+#include <time.h>       // clock_gettime
+#ifdef __linux__
+#include <linux/perf_event.h>   // perf_event_attr
+#include <sys/ioctl.h>          // ioctl
+#include <sys/syscall.h>        // SYS_perf_event_open
+#include <unistd.h>             // syscall
+#endif
+
+#define FCL_BENCH_MAX_RESULTS 256
+#define FCL_BENCH_NUM_COUNTERS 4
+#define FCL_BENCH_WARMUP 3
+
+typedef void (*fcl_bench_fn)(void *ctx);
+
+struct fcl_bench_result {
+  char name[64];
+  size_t ops;
+  size_t iterations;
+  double min_ns;
+  double mean_ns;
+  double p50_ns;
+  double p90_ns;
+  double p99_ns;
+  int has_counters;
+  double counters[FCL_BENCH_NUM_COUNTERS];
+};
+
+struct fcl_bench {
+  size_t iterations;
+  size_t size;
+  const char *format;
+  const char *filter;
+  FILE *out;
+  int counter_fds[FCL_BENCH_NUM_COUNTERS];
+  size_t num_results;
+  struct fcl_bench_result results[FCL_BENCH_MAX_RESULTS];
+};
+
+static const char *fcl_bench_counter_names[FCL_BENCH_NUM_COUNTERS] = {
+  "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+static inline uint64_t fcl_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// xorshift64*, good enough to shuffle benchmark inputs reproducibly
+static inline uint64_t fcl_bench_rand(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ull;
+}
+
+// shuffles the @n elements of @size bytes at @base
+static inline void fcl_bench_shuffle(void *base, size_t n, size_t size,
+                                     uint64_t seed) {
+  unsigned char *a = base, tmp;
+  size_t i, j, k;
+  for (i = n; i > 1; i--) {
+    j = fcl_bench_rand(&seed) % i;
+    for (k=0; k < size; k++) {
+      tmp = a[(i-1)*size + k];
+      a[(i-1)*size + k] = a[j*size + k];
+      a[j*size + k] = tmp;
+    }
+  }
+}
+
+static inline void fcl_bench_counters_open(struct fcl_bench *b) {
+  int i;
+  for (i=0; i < FCL_BENCH_NUM_COUNTERS; i++)
+    b->counter_fds[i] = -1;
+#ifdef __linux__
+  static const uint64_t configs[FCL_BENCH_NUM_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+  };
+  struct perf_event_attr attr;
+  for (i=0; i < FCL_BENCH_NUM_COUNTERS; i++) {
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    b->counter_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+#endif
+}
+
+static inline void fcl_bench_counters_close(struct fcl_bench *b) {
+#ifdef __linux__
+  int i;
+  for (i=0; i < FCL_BENCH_NUM_COUNTERS; i++)
+    if (b->counter_fds[i] >= 0)
+      close(b->counter_fds[i]);
+#else
+  (void)b;
+#endif
+}
+
+static inline void fcl_bench_counters_start(struct fcl_bench *b) {
+#ifdef __linux__
+  int i;
+  for (i=0; i < FCL_BENCH_NUM_COUNTERS; i++) {
+    if (b->counter_fds[i] < 0)
+      continue;
+    ioctl(b->counter_fds[i], PERF_EVENT_IOC_RESET, 0);
+    ioctl(b->counter_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+  }
+#else
+  (void)b;
+#endif
+}
+
+// returns 1 if every counter was read into @values
+static inline int fcl_bench_counters_stop(struct fcl_bench *b,
+                                          uint64_t *values) {
+  int i, ok = 1;
+  for (i=0; i < FCL_BENCH_NUM_COUNTERS; i++) {
+    values[i] = 0;
+#ifdef __linux__
+    if (b->counter_fds[i] >= 0) {
+      ioctl(b->counter_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (read(b->counter_fds[i], &values[i], sizeof(values[i])) ==
+          sizeof(values[i]))
+        continue;
+    }
+#endif
+    ok = 0;
+  }
+  return ok;
+}
+
+static inline void fcl_bench_usage(FILE *f, const char *prog) {
+  fprintf(f, "usage: %s [-i iterations] [-n size] [-f csv|json] "
+          "[-o file] [-b filter]\n", prog);
+}
+
+static inline void fcl_bench_init(struct fcl_bench *b, int argc, char **argv,
+                                  size_t default_size) {
+  const char *opt, *val;
+  int i;
+  b->iterations = 50;
+  b->size = default_size;
+  b->format = "csv";
+  b->filter = NULL;
+  b->out = stdout;
+  b->num_results = 0;
+  for (i=1; i < argc; i += 2) {
+    opt = argv[i];
+    if (!strcmp(opt, "-h")) {
+      fcl_bench_usage(stdout, argv[0]);
+      exit(0);
+    }
+    if (opt[0] != '-' || strlen(opt) != 2 || !strchr("inbfo", opt[1])) {
+      fprintf(stderr, "%s: unknown option %s\n", argv[0], opt);
+      fcl_bench_usage(stderr, argv[0]);
+      exit(2);
+    }
+    if (i + 1 == argc) {
+      fprintf(stderr, "%s: missing value for %s\n", argv[0], opt);
+      fcl_bench_usage(stderr, argv[0]);
+      exit(2);
+    }
+    val = argv[i+1];
+    if (opt[1] == 'i')
+      b->iterations = strtoul(val, NULL, 10);
+    else if (opt[1] == 'n')
+      b->size = strtoul(val, NULL, 10);
+    else if (opt[1] == 'b')
+      b->filter = val;
+    else if (opt[1] == 'f' && strcmp(val, "csv") && strcmp(val, "json")) {
+      fprintf(stderr, "%s: unknown format %s\n", argv[0], val);
+      exit(2);
+    } else if (opt[1] == 'f') {
+      b->format = val;
+    } else if (!(b->out = fopen(val, "w"))) {
+      fprintf(stderr, "%s: %s: %s\n", argv[0], val, strerror(errno));
+      exit(2);
+    }
+  }
+  if (!b->iterations)
+    b->iterations = 1;
+  fcl_bench_counters_open(b);
+}
+
+static int fcl_bench_cmp_double(const void *a, const void *b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// runs @fn, which performs @ops operations per call, and records the time
+// per operation under @name.  @setup, if set, runs untimed before each call.
+static inline void fcl_bench_run(struct fcl_bench *b, const char *name,
+                                 size_t ops, fcl_bench_fn setup,
+                                 fcl_bench_fn fn, void *ctx) {
+  struct fcl_bench_result *r;
+  uint64_t start, counters[FCL_BENCH_NUM_COUNTERS];
+  double *samples;
+  size_t i;
+  int j;
+
+  if (b->filter && !strstr(name, b->filter))
+    return;
+  if (b->num_results == FCL_BENCH_MAX_RESULTS || !ops)
+    return;
+  samples = malloc(sizeof(*samples) * b->iterations);
+  if (!samples)
+    return;
+  r = &b->results[b->num_results++];
+  memset(r, 0, sizeof(*r));
+  snprintf(r->name, sizeof(r->name), "%s", name);
+  r->ops = ops;
+  r->iterations = b->iterations;
+  r->has_counters = 1;
+
+  for (i=0; i < FCL_BENCH_WARMUP; i++) {
+    if (setup)
+      setup(ctx);
+    fn(ctx);
+  }
+  for (i=0; i < b->iterations; i++) {
+    if (setup)
+      setup(ctx);
+    fcl_bench_counters_start(b);
+    start = fcl_bench_now_ns();
+    fn(ctx);
+    samples[i] = (double)(fcl_bench_now_ns() - start) / ops;
+    r->has_counters &= fcl_bench_counters_stop(b, counters);
+    for (j=0; j < FCL_BENCH_NUM_COUNTERS; j++)
+      r->counters[j] += (double)counters[j] / ops / b->iterations;
+    r->mean_ns += samples[i] / b->iterations;
+  }
+
+  qsort(samples, b->iterations, sizeof(*samples), fcl_bench_cmp_double);
+  r->min_ns = samples[0];
+  r->p50_ns = samples[b->iterations * 50 / 100];
+  r->p90_ns = samples[b->iterations * 90 / 100];
+  r->p99_ns = samples[b->iterations * 99 / 100];
+  free(samples);
+}
+
+static inline void fcl_bench_report(struct fcl_bench *b) {
+  struct fcl_bench_result *r;
+  size_t i;
+  int j, json = !strcmp(b->format, "json");
+
+  if (json)
+    fprintf(b->out, "[\n");
+  else
+    fprintf(b->out, "benchmark,ops,iterations,min_ns,mean_ns,p50_ns,p90_ns,"
+            "p99_ns,%s,%s,%s,%s\n", fcl_bench_counter_names[0],
+            fcl_bench_counter_names[1], fcl_bench_counter_names[2],
+            fcl_bench_counter_names[3]);
+  for (i=0; i < b->num_results; i++) {
+    r = &b->results[i];
+    if (json) {
+      fprintf(b->out, "  {\"benchmark\": \"%s\", \"ops\": %zu, "
+              "\"iterations\": %zu, \"min_ns\": %.3f, \"mean_ns\": %.3f, "
+              "\"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f",
+              r->name, r->ops, r->iterations, r->min_ns, r->mean_ns,
+              r->p50_ns, r->p90_ns, r->p99_ns);
+      for (j=0; j < FCL_BENCH_NUM_COUNTERS; j++) {
+        if (r->has_counters)
+          fprintf(b->out, ", \"%s\": %.3f", fcl_bench_counter_names[j],
+                  r->counters[j]);
+        else
+          fprintf(b->out, ", \"%s\": null", fcl_bench_counter_names[j]);
+      }
+      fprintf(b->out, "}%s\n", i + 1 < b->num_results ? "," : "");
+    } else {
+      fprintf(b->out, "%s,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.3f", r->name, r->ops,
+              r->iterations, r->min_ns, r->mean_ns, r->p50_ns, r->p90_ns,
+              r->p99_ns);
+      for (j=0; j < FCL_BENCH_NUM_COUNTERS; j++) {
+        if (r->has_counters)
+          fprintf(b->out, ",%.3f", r->counters[j]);
+        else
+          fprintf(b->out, ",");
+      }
+      fprintf(b->out, "\n");
+    }
+  }
+  if (json)
+    fprintf(b->out, "]\n");
+}
+
+static inline void fcl_bench_finish(struct fcl_bench *b) {
+  fcl_bench_report(b);
+  fcl_bench_counters_close(b);
+  if (b->out != stdout)
+    fclose(b->out);
+}
+
+#endif  // _FCL_BENCH_H_
@@ -0,0 +1,222 @@
+#include <algorithm>          // find_if, count_if
+#include <cstdio>             // printf
+#include <thread>             // thread
+#include <vector>             // vector
+#include "fcl.hpp"
+
+#define NUM_NODES 1000
+#define NUM_EVENTS 100
+
+struct my_node {
+  explicit my_node(int i) : id(i), priority(i % 7) {}
+  int id;
+  int priority;
+  fcl_list_links links;   // run queue
+  fcl_list_link link;     // completion queue
+};
+
+// runs on every node the pool takes back
+struct reset_node {
+  void operator()(my_node *n) const { n->priority = -1; }
+};
+
+// no DEFINE macros: the templates are instantiated where they are used
+typedef fcl::pool<my_node, fcl::fifo_grow, reset_node> node_pool;
+typedef fcl::pool<my_node,
+                  fcl::pool_policy<false, FCL_ALLOCATOR_OOM_POLICY_ERROR,
+                                   FCL_ALLOCATOR_BACKEND_ALIGNED_ALLOC, 0,
+                                   true> > remote_pool;
+typedef fcl::intrusive_list<my_node, &my_node::links> node_list;
+typedef fcl::intrusive_slist<my_node, &my_node::link> node_slist;
+
+// the C macros also compile as C++, for code shared with C
+struct event {
+  int when;
+  fcl_list_links links;
+  fcl_list_link link;
+};
+
+FCL_ALLOCATOR_LL_DECLARE(event, struct event, struct fcl_list_link, link, LIFO)
+FCL_ALLOCATOR_LL_DEFINE(event, struct event, struct fcl_list_link, link, LIFO)
+FCL_ALLOCATOR_LL_DEFINE_STATIC(sevent, struct event, struct fcl_list_links,
+                               links, FIFO, INCREMENTAL)
+FCL_LIST_DL_DECLARE(event_dl, struct event, links)
+FCL_LIST_DL_DEFINE(event_dl, struct event, links)
+FCL_LIST_FIFO_DECLARE(event_fifo, struct event, struct fcl_list_link, link)
+FCL_LIST_FIFO_DEFINE(event_fifo, struct event, struct fcl_list_link, link)
+FCL_LIST_LIFO_LEN_DEFINE_STATIC(event_lifo, struct event, struct fcl_list_link,
+                                link)
+
+// function declarations
+int event_cmp(struct event *a, struct event *b);
+void event_count(struct event *e, void *ctx);
+int c_macros();
+
+int main() {
+  // starts small so the pool has to grow
+  node_pool pool(16);
+  node_list run;
+  node_slist done;
+  int i;
+
+  for (i=0; i < NUM_NODES; i++) {
+    my_node *n = pool.make(i);
+    if (!n)
+      return 1;
+    if (i % 2)
+      run.push_back(*n);
+    else
+      run.push_front(*n);
+  }
+  printf("pool: %zu in use of %zu\n", pool.in_use(), pool.total_count());
+
+  // std algorithms work on the intrusive iterators
+  node_list::iterator it = std::find_if(run.begin(), run.end(),
+                                        [](const my_node &n) {
+                                          return n.id == 500;
+                                        });
+  if (it == run.end())
+    return 1;
+  long high = std::count_if(run.cbegin(), run.cend(),
+                            [](const my_node &n) { return n.priority > 3; });
+  printf("found id %d, %ld nodes with priority > 3\n", it->id, high);
+
+  // move every high priority node to the completion queue
+  for (it = run.begin(); it != run.end(); ) {
+    my_node &n = *it;
+    if (n.priority > 3) {
+      it = run.erase(it);
+      done.push_back(n);
+    } else {
+      ++it;
+    }
+  }
+  if (done.size() != (size_t)high || run.size() != (size_t)(NUM_NODES - high))
+    return 1;
+
+  // the head is an FCL_LIST_DL sentinel, so the C macros see the same list
+  fcl_list_links *l, *tmp;
+  size_t walked = 0;
+  FCL_LIST_DL_EACH(run.head(), l, tmp)
+    walked++;
+  if (walked != run.size())
+    return 1;
+
+  // odd ids were pushed at the back, so the last is the highest one left
+  printf("last: id %d\n", run.rbegin()->id);
+
+  for (my_node &n : done)
+    pool.destroy(&n);
+  done.clear();
+  while (!run.empty()) {
+    my_node &n = run.front();
+    run.pop_front();
+    pool.destroy(&n);
+  }
+  if (pool.in_use())
+    return 1;
+
+  // a handle gives its node back when it goes out of scope
+  {
+    node_pool::handle h = pool.make_unique(42);
+    printf("handle: id %d, %zu in use\n", h->id, pool.in_use());
+  }
+  printf("pool: %zu in use of %zu\n", pool.in_use(), pool.total_count());
+  if (pool.in_use())
+    return 1;
+
+  // the pool is the C allocator: its init callback, trim and policies
+  my_node *n = pool.borrow();
+  if (n->priority != -1)
+    return 1;
+  pool.give_back(n);
+  pool.set_init_policy(FCL_ALLOCATOR_INIT_POLICY_NONE);
+  size_t total = pool.total_count();
+  printf("trim: released %zu of %zu\n", pool.trim(0), total);
+
+  // a pool with a remote free list takes its nodes back from another thread
+  remote_pool rpool(NUM_EVENTS);
+  std::vector<my_node*> borrowed;
+  while ((n = rpool.make(0)))
+    borrowed.push_back(n);
+  std::thread worker([&rpool, &borrowed] {
+    for (my_node *e : borrowed) {
+      e->~my_node();
+      rpool.give_back_remote(e);
+    }
+  });
+  worker.join();
+  size_t reclaimed = rpool.reclaim();
+  printf("remote: %zu reclaimed, %zu in use\n", reclaimed, rpool.in_use());
+  if (rpool.in_use())
+    return 1;
+
+  return c_macros();
+}
+
+int event_cmp(struct event *a, struct event *b) {
+  return a->when - b->when;
+}
+
+void event_count(struct event *e, void *ctx) {
+  (void)e;
+  (*(int*)ctx)++;
+}
+
+int c_macros() {
+  struct event_allocator alloc;
+  struct sevent_allocator salloc;
+  struct event_fifo_list_head fifo;
+  struct event_lifo_list_head lifo;
+  struct fcl_list_links dl, *l, *tmp;
+  struct fcl_list_link *i, *next, *ahead;
+  struct event *e;
+  int k, count = 0, prev = -1;
+
+  if (event_allocator_init(&alloc, 16, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                           NULL) != 1 ||
+      sevent_allocator_init(&salloc, 16,
+                            FCL_ALLOCATOR_OOM_POLICY_INCREMENTAL, 16,
+                            NULL) != 1)
+    return 1;
+  fcl_list_dl_init(&dl);
+  event_fifo_list_head_init(&fifo);
+  event_lifo_list_head_init(&lifo);
+  for (k=0; k < NUM_EVENTS; k++) {
+    e = event_allocator_borrow(&alloc);
+    e->when = (k * 37) % NUM_EVENTS;
+    event_dl_list_insert_tail(&dl, e);
+    e = sevent_allocator_borrow(&salloc);
+    e->when = k;
+    event_lifo_list_insert(&lifo, e);
+  }
+
+  event_dl_list_sort(&dl, event_cmp);
+  FCL_LIST_DL_EACH(&dl, l, tmp) {
+    e = event_dl_list_get_entry(l);
+    if (e->when <= prev)
+      return 1;
+    prev = e->when;
+    event_dl_list_remove(e);
+    event_fifo_list_insert(&fifo, e);
+  }
+  event_fifo_list_for_each(&fifo, event_count, &count);
+  FCL_LIST_FIFO_EACH_PREFETCH(event_fifo, &fifo, i, next, ahead, 4)
+    count++;
+  if (count != 2 * NUM_EVENTS || event_lifo_list_len(&lifo) != NUM_EVENTS)
+    return 1;
+  printf("c macros: %d events sorted, %zu on the lifo\n", prev + 1,
+         event_lifo_list_len(&lifo));
+
+  while ((e = event_fifo_list_remove(&fifo)))
+    event_allocator_return(&alloc, e);
+  while ((e = event_lifo_list_remove(&lifo)))
+    sevent_allocator_return(&salloc, e);
+  if (alloc.free_count != alloc.total_count ||
+      salloc.free_count != salloc.total_count)
+    return 1;
+  event_allocator_freeall(&alloc);
+  sevent_allocator_freeall(&salloc);
+
+  return 0;
+}
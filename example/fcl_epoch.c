@@ -0,0 +1,170 @@
+#include <stdio.h>            // printf
+#include <pthread.h>          // pthread_create
+#include <sched.h>            // sched_yield
+#include <stdatomic.h>        // atomic_int
+#include "fcl_allocator.h"
+#include "fcl_epoch.h"
+
+#define NUM_READERS 4
+#define NUM_KEYS 64
+#define POOL_SIZE (2 * NUM_KEYS)
+#define NUM_UPDATES 100000
+#define POISON -1
+
+struct route {
+  long key;
+  long value;                   // key + generation * NUM_KEYS
+  struct fcl_list_links links;  // the table, walked by the readers
+  struct fcl_list_link rlink;   // allocator free list, or limbo once retired
+};
+
+FCL_ALLOCATOR_LL_DECLARE(route, struct route, struct fcl_list_link, rlink,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(route, struct route, struct fcl_list_link, rlink,
+                        LIFO)
+
+FCL_LIST_DL_DECLARE(route, struct route, links)
+FCL_LIST_DL_DEFINE(route, struct route, links)
+
+FCL_EPOCH_DECLARE(route, struct route, struct fcl_list_link, rlink)
+FCL_EPOCH_DEFINE(route, struct route, struct fcl_list_link, rlink)
+
+struct reader {
+  pthread_t thread;
+  long lookups;
+  long misses;
+  long torn;
+};
+
+struct fcl_epoch domain;
+struct fcl_list_links table;
+struct route_allocator route_alloc;
+struct reader readers[NUM_READERS];
+atomic_int done;
+
+// function declarations
+void route_poison(struct route *r);
+void route_free(struct route *r, void *ctx);
+void *reader(void *arg);
+
+int main() {
+  struct route_epoch_limbo limbo;
+  struct route *r, *old = NULL;
+  struct fcl_list_links *i, *tmp;
+  long n, lookups = 0, misses = 0, torn = 0;
+  size_t waits = 0;
+  int k;
+
+  // a fixed pool: every update needs a node, so the writer only keeps going
+  // because retired routes come back once the readers have moved on
+  if (route_allocator_init(&route_alloc, POOL_SIZE,
+                           FCL_ALLOCATOR_OOM_POLICY_ERROR, 0,
+                           route_poison) != 1)
+    return 1;
+  fcl_epoch_init(&domain);
+  route_epoch_limbo_init(&limbo, &domain, route_free, &route_alloc);
+  fcl_list_dl_init(&table);
+  for (k=0; k < NUM_KEYS; k++) {
+    r = route_allocator_borrow(&route_alloc);
+    r->key = k;
+    r->value = k;
+    fcl_epoch_dl_insert_after(table.prev, &r->links);
+  }
+
+  atomic_init(&done, 0);
+  for (k=0; k < NUM_READERS; k++)
+    pthread_create(&readers[k].thread, NULL, reader, &readers[k]);
+
+  // the single writer replaces one route per update
+  for (n=0; n < NUM_UPDATES; n++) {
+    k = n % NUM_KEYS;
+    FCL_LIST_DL_EACH(&table, i, tmp) {
+      old = route_list_get_entry(i);
+      if (old->key == k)
+        break;
+    }
+    while (!(r = route_allocator_borrow(&route_alloc))) {
+      waits++;
+      fcl_epoch_try_advance(&domain);
+      route_epoch_collect(&limbo);
+      sched_yield();
+    }
+    r->key = k;
+    r->value = old->value + NUM_KEYS;
+    fcl_epoch_dl_insert_after(&old->links, &r->links);
+    fcl_epoch_dl_remove(&old->links);
+    route_epoch_retire(&limbo, old);
+  }
+  atomic_store(&done, 1);
+
+  for (k=0; k < NUM_READERS; k++) {
+    pthread_join(readers[k].thread, NULL);
+    lookups += readers[k].lookups;
+    misses += readers[k].misses;
+    torn += readers[k].torn;
+  }
+  route_epoch_drain(&limbo);
+
+  printf("updates: %d, lookups: %ld, misses: %ld, reused under a reader: "
+         "%ld\n", NUM_UPDATES, lookups, misses, torn);
+  printf("pool: %zu, free: %zu, empty pool waits: %zu\n",
+         route_alloc.total_count, route_alloc.free_count, waits);
+  if (misses || torn || route_alloc.free_count != POOL_SIZE - NUM_KEYS)
+    return 1;
+  FCL_LIST_DL_EACH(&table, i, tmp) {
+    r = route_list_get_entry(i);
+    route_list_remove(r);
+    route_allocator_return(&route_alloc, r);
+  }
+  route_allocator_freeall(&route_alloc);
+
+  return 0;
+}
+
+// the allocator overwrites every returned route, as a reused one would be
+void route_poison(struct route *r) {
+  r->key = POISON;
+  r->value = POISON;
+}
+
+void route_free(struct route *r, void *ctx) {
+  route_allocator_return(ctx, r);
+}
+
+void *reader(void *arg) {
+  struct reader *self = arg;
+  struct fcl_epoch_record *rec;
+  struct fcl_list_links *i;
+  struct route *r;
+  long key = 0;
+  int found;
+
+  if (!(rec = fcl_epoch_register(&domain)))
+    return NULL;
+  self->lookups = self->misses = self->torn = 0;
+  while (!atomic_load_explicit(&done, memory_order_relaxed)) {
+    key = (key + 7) % NUM_KEYS;
+    found = 0;
+    fcl_epoch_enter(&domain, rec);
+    FCL_EPOCH_DL_EACH(&table, i) {
+      r = route_list_get_entry(i);
+      if (r->key == POISON || r->value % NUM_KEYS != r->key) {
+        self->torn++;
+        break;
+      }
+      if (r->key == key) {
+        found = 1;
+        break;
+      }
+    }
+    fcl_epoch_exit(rec);
+    self->lookups++;
+    if (!found)
+      self->misses++;
+    // leave the writer room to run when there are fewer cores than threads
+    if (!(self->lookups % 64))
+      sched_yield();
+  }
+  fcl_epoch_unregister(rec);
+  return NULL;
+}
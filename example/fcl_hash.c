@@ -0,0 +1,105 @@
+#include <stdint.h>           // uint64_t
+#include <stdio.h>            // printf
+#include "fcl_allocator.h"
+#include "fcl_hash.h"
+
+#define NUM_CONNS 100000
+
+struct conn {
+  uint64_t id;
+  int state;
+  struct fcl_list_link link;    // used by the allocator free list
+  struct fcl_list_link hlink;   // used by the hash table
+};
+
+FCL_ALLOCATOR_LL_DECLARE(conn, struct conn, struct fcl_list_link, link, LIFO)
+FCL_ALLOCATOR_LL_DEFINE(conn, struct conn, struct fcl_list_link, link, LIFO)
+
+// index the connections by id
+FCL_HASH_DECLARE(conns, struct conn, uint64_t, hlink, id, fcl_hash_u64,
+                 FCL_HASH_EQ)
+FCL_HASH_DEFINE(conns, struct conn, uint64_t, hlink, id, fcl_hash_u64,
+                FCL_HASH_EQ)
+
+int main() {
+  struct conn_allocator alloc;
+  struct conns_hash table, small;
+  struct conn *c;
+  struct fcl_list_link *chain, *iter, *tmp;
+  uint64_t id;
+  size_t n;
+
+  conn_allocator_init(&alloc, 1024, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0, NULL);
+  conns_hash_init(&table, 0);
+
+  // every insert may be in the middle of an incremental resize
+  for (id=0; id < NUM_CONNS; id++) {
+    c = conn_allocator_borrow(&alloc);
+    c->id = id * 7;
+    c->state = 0;
+    conns_hash_insert(&table, c);
+    if (conns_hash_find(&table, id / 2 * 7) == NULL) {
+      printf("lost id %llu\n", (unsigned long long)(id / 2 * 7));
+      return 1;
+    }
+  }
+  printf("count: %zu, buckets: %zu\n", conns_hash_count(&table),
+         table.mask + 1);
+
+  // a duplicate key is found newest first, across every resize of a table
+  // that starts with one bucket
+  conns_hash_init(&small, 1);
+  for (id=0; id < 2; id++) {
+    c = conn_allocator_borrow(&alloc);
+    c->id = 7;
+    c->state = id;
+    conns_hash_insert(&small, c);
+  }
+  for (id=0; id < 64; id++) {
+    c = conn_allocator_borrow(&alloc);
+    c->id = (id + 2) * 7;
+    c->state = 0;
+    conns_hash_insert(&small, c);
+    if (conns_hash_find(&small, 7)->state != 1) {
+      printf("older duplicate found at %zu entries\n",
+             conns_hash_count(&small));
+      return 1;
+    }
+  }
+  chain = conns_hash_remove_all(&small);
+  FCL_HASH_CHAIN_EACH(chain, iter, tmp)
+    conn_allocator_return(&alloc, conns_hash_get_entry(iter));
+  conns_hash_freeall(&small);
+
+  // remove the odd ids by key and return them to the allocator
+  for (id=1; id < NUM_CONNS; id += 2) {
+    c = conns_hash_remove_key(&table, id * 7);
+    if (!c)
+      return 1;
+    conn_allocator_return(&alloc, c);
+  }
+  if (conns_hash_find(&table, 7) || !conns_hash_find(&table, 14))
+    return 1;
+
+  // an entry may also be removed by pointer
+  c = conns_hash_find(&table, 0);
+  if (conns_hash_remove(&table, c) != 1 || conns_hash_remove(&table, c) != -1)
+    return 1;
+  conn_allocator_return(&alloc, c);
+  printf("count after removes: %zu\n", conns_hash_count(&table));
+
+  // empty the table and hand every entry back
+  n = 0;
+  chain = conns_hash_remove_all(&table);
+  FCL_HASH_CHAIN_EACH(chain, iter, tmp) {
+    conn_allocator_return(&alloc, conns_hash_get_entry(iter));
+    n++;
+  }
+  printf("drained: %zu, allocator free: %zu of %zu\n", n, alloc.free_count,
+         alloc.total_count);
+
+  conns_hash_freeall(&table);
+  conn_allocator_freeall(&alloc);
+
+  return 0;
+}
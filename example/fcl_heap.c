@@ -0,0 +1,85 @@
+#include <stdio.h>            // printf
+#include <stdlib.h>           // rand
+#include "fcl_allocator.h"
+#include "fcl_heap.h"
+
+#define NUM_NODES 10000
+
+struct my_node {
+  int id;
+  int priority;
+  struct fcl_list_link link;    // allocator free list
+  struct fcl_heap_link hlink;   // priority queue
+};
+
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_link, link,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_link, link,
+                        LIFO)
+
+// the lowest priority value is popped first
+#define node_lt(a, b) ((a)->priority < (b)->priority)
+FCL_HEAP_DECLARE(node, struct my_node, hlink, node_lt)
+FCL_HEAP_DEFINE(node, struct my_node, hlink, node_lt)
+
+int main() {
+  struct node_allocator alloc;
+  struct node_heap heap, other;
+  struct my_node *nodes[NUM_NODES], *entry;
+  int i, last, popped;
+
+  srand(1);
+  node_allocator_init(&alloc, NUM_NODES, FCL_ALLOCATOR_OOM_POLICY_ERROR, 0,
+                      NULL);
+  node_heap_init(&heap);
+  node_heap_init(&other);
+
+  // the first half goes into a second heap, melded in below
+  for (i=0; i < NUM_NODES; i++) {
+    nodes[i] = node_allocator_borrow(&alloc);
+    nodes[i]->id = i;
+    nodes[i]->priority = rand() % 100000;
+    node_heap_insert(i < NUM_NODES / 2 ? &other : &heap, nodes[i]);
+  }
+  node_heap_meld(&heap, &other);
+  if (!node_heap_is_empty(&other) || node_heap_count(&heap) != NUM_NODES)
+    return 1;
+
+  // pop one so the heap is no longer a single list of children
+  entry = node_heap_pop_min(&heap);
+  printf("min: id %d priority %d\n", entry->id, entry->priority);
+  nodes[entry->id] = NULL;
+  node_allocator_return(&alloc, entry);
+
+  // every 7th node gets more urgent, every 11th is cancelled
+  for (i=0; i < NUM_NODES; i++) {
+    if (!nodes[i])
+      continue;
+    if (i % 11 == 0) {
+      node_heap_remove(&heap, nodes[i]);
+      node_allocator_return(&alloc, nodes[i]);
+    } else if (i % 7 == 0) {
+      nodes[i]->priority -= 50000;
+      node_heap_decrease_key(&heap, nodes[i]);
+    }
+  }
+  printf("count: %zu\n", node_heap_count(&heap));
+
+  // the remaining nodes come out in order
+  last = -50000;
+  popped = 0;
+  while ((entry = node_heap_pop_min(&heap))) {
+    if (entry->priority < last) {
+      printf("out of order: %d after %d\n", entry->priority, last);
+      return 1;
+    }
+    last = entry->priority;
+    popped++;
+    node_allocator_return(&alloc, entry);
+  }
+  printf("popped: %d, allocator free: %zu of %zu\n", popped, alloc.free_count,
+         alloc.total_count);
+  node_allocator_freeall(&alloc);
+
+  return 0;
+}
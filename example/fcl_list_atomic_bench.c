@@ -0,0 +1,166 @@
+#include <stdio.h>            // printf
+#include <pthread.h>          // pthread_create
+#include "fcl_allocator.h"
+#include "fcl_list_atomic.h"
+#include "fcl_list.h"
+#include "fcl_bench.h"
+
+#define NUM_NODES 4096
+#define DEFAULT_OPS 1000000
+#define MAX_THREADS 8
+#define BATCH 8
+
+struct my_node {
+  int id;
+  int priority;
+  struct fcl_list_link link;
+};
+
+// the allocator free list is the lock-free stack
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_link, link,
+                         LIFO_ATOMIC)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_link, link,
+                        LIFO_ATOMIC)
+
+// a lock-free and a mutex protected stack of the same nodes
+FCL_LIST_LIFO_ATOMIC_DECLARE(astack, struct my_node, struct fcl_list_link,
+                             link)
+FCL_LIST_LIFO_ATOMIC_DEFINE(astack, struct my_node, struct fcl_list_link,
+                            link)
+FCL_LIST_LIFO_DECLARE(mstack, struct my_node, struct fcl_list_link, link)
+FCL_LIST_LIFO_DEFINE(mstack, struct my_node, struct fcl_list_link, link)
+
+struct astack_list_head astack;
+struct mstack_list_head mstack;
+pthread_mutex_t mstack_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct ctx {
+  void *(*worker)(void *);
+  int num_threads;
+  size_t ops;
+};
+
+// function declarations
+int drain(struct node_allocator *a, int stack, unsigned char *seen);
+void *atomic_worker(void *arg);
+void *mutex_worker(void *arg);
+void run(void *arg);
+
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  struct node_allocator node_alloc;
+  struct my_node *entry;
+  struct ctx c;
+  static unsigned char seen[NUM_NODES];
+  char name[64];
+  int i;
+
+  fcl_bench_init(&b, argc, argv, DEFAULT_OPS);
+  node_allocator_init(&node_alloc, NUM_NODES, FCL_ALLOCATOR_OOM_POLICY_ERROR,
+                      0, NULL);
+  astack_list_head_init(&astack);
+  mstack_list_head_init(&mstack);
+  for (i=0; i < NUM_NODES; i++) {
+    entry = node_allocator_borrow(&node_alloc);
+    entry->id = i;
+    if (i % 2)
+      mstack_list_insert(&mstack, entry);
+    else
+      astack_list_insert(&astack, entry);
+  }
+
+  // each thread performs b.size removes and inserts
+  c.ops = b.size;
+  for (c.num_threads = 1; c.num_threads <= MAX_THREADS; c.num_threads *= 2) {
+    c.worker = atomic_worker;
+    snprintf(name, sizeof(name), "lifo_atomic_t%d", c.num_threads);
+    fcl_bench_run(&b, name, c.ops * c.num_threads, NULL, run, &c);
+    c.worker = mutex_worker;
+    snprintf(name, sizeof(name), "lifo_mutex_t%d", c.num_threads);
+    fcl_bench_run(&b, name, c.ops * c.num_threads, NULL, run, &c);
+  }
+  fcl_bench_finish(&b);
+
+  // every node must still be on its stack exactly once
+  if (drain(&node_alloc, 0, seen) != NUM_NODES / 2 ||
+      drain(&node_alloc, 1, seen) != NUM_NODES / 2) {
+    fprintf(stderr, "stacks lost or duplicated nodes\n");
+    return 1;
+  }
+  node_allocator_freeall(&node_alloc);
+
+  return 0;
+}
+
+// empties the atomic (stack 0) or mutex (stack 1) stack and returns the
+// number of nodes it held, or -1 if it held a node twice or a node of the
+// other stack
+int drain(struct node_allocator *a, int stack, unsigned char *seen) {
+  struct my_node *entry;
+  int n = 0;
+
+  while ((entry = stack ? mstack_list_remove(&mstack) :
+                          astack_list_remove(&astack))) {
+    if (entry->id < 0 || entry->id >= NUM_NODES ||
+        entry->id % 2 != stack || seen[entry->id]++)
+      return -1;
+    node_allocator_return(a, entry);
+    if (++n > NUM_NODES)
+      return -1;
+  }
+  return n;
+}
+
+void run(void *arg) {
+  struct ctx *c = arg;
+  pthread_t threads[MAX_THREADS];
+  int i;
+
+  for (i=0; i < c->num_threads; i++)
+    pthread_create(&threads[i], NULL, c->worker, c);
+  for (i=0; i < c->num_threads; i++)
+    pthread_join(threads[i], NULL);
+}
+
+void *atomic_worker(void *arg) {
+  struct ctx *c = arg;
+  struct my_node *batch[BATCH];
+  size_t i;
+  int j, n;
+
+  for (i=0; i < c->ops; i += BATCH) {
+    for (n=0; n < BATCH; n++) {
+      batch[n] = astack_list_remove(&astack);
+      if (!batch[n])
+        break;
+    }
+    for (j=0; j < n; j++)
+      astack_list_insert(&astack, batch[j]);
+  }
+
+  return NULL;
+}
+
+void *mutex_worker(void *arg) {
+  struct ctx *c = arg;
+  struct my_node *batch[BATCH];
+  size_t i;
+  int j, n;
+
+  for (i=0; i < c->ops; i += BATCH) {
+    for (n=0; n < BATCH; n++) {
+      pthread_mutex_lock(&mstack_lock);
+      batch[n] = mstack_list_remove(&mstack);
+      pthread_mutex_unlock(&mstack_lock);
+      if (!batch[n])
+        break;
+    }
+    for (j=0; j < n; j++) {
+      pthread_mutex_lock(&mstack_lock);
+      mstack_list_insert(&mstack, batch[j]);
+      pthread_mutex_unlock(&mstack_lock);
+    }
+  }
+
+  return NULL;
+}
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "fcl_list.h"
 
 
@@ -15,6 +16,80 @@ FCL_LIST_FIFO_DECLARE(node, struct my_node, struct fcl_list_link, links)
 // generate the functions for the list of my_node
 FCL_LIST_FIFO_DEFINE(node, struct my_node, struct fcl_list_link, links)
 
+// the same list with a length
+FCL_LIST_FIFO_LEN_DECLARE(lnode, struct my_node, struct fcl_list_link, links)
+FCL_LIST_FIFO_LEN_DEFINE(lnode, struct my_node, struct fcl_list_link, links)
+
+// checks that the list from @first to @last holds the nodes with the ids
+// @ids in order and, unless @len is -1, that it holds @len nodes
+int check(const char *what, struct fcl_list_link *first,
+          struct fcl_list_link *last, size_t len, const char *ids) {
+  struct fcl_list_link *l, *prev = NULL;
+  const char *k;
+
+  for (l = first, k = ids; l && *k; prev = l, l = l->next, k++)
+    if (FCL_CONTAINER_OF(l, struct my_node, links)->id != *k - '0')
+      break;
+  if (l || *k || (prev && prev != last) ||
+      (len != (size_t)-1 && len != strlen(ids))) {
+    printf("%s: expected \"%s\"\n", what, ids);
+    return 1;
+  }
+  return 0;
+}
+
+#define NOLEN(h) ((size_t)-1)
+
+// runs concat, splice, move_all and split_at on the lists of prefix @name,
+// checking both lists after each, including empty sources and splits at
+// the last node
+#define DEFINE_OPS_CHECK(name, len) \
+int name##_ops_check(struct my_node *n) { \
+  struct name##_list_head a, b; \
+  int i, err = 0; \
+  name##_list_head_init(&a); \
+  name##_list_head_init(&b); \
+  for (i=0; i < 10; i++) \
+    name##_list_insert(i < 5 ? &a : &b, &n[i]); \
+  for (i=0; i < 10; i++) \
+    n[i].id = i; \
+  err |= CHECK(name, &a, len, "01234"); \
+  err |= CHECK(name, &b, len, "56789"); \
+  name##_list_concat(&a, &b); \
+  err |= CHECK(name, &a, len, "0123456789"); \
+  err |= CHECK(name, &b, len, ""); \
+  name##_list_concat(&a, &b); \
+  err |= CHECK(name, &a, len, "0123456789"); \
+  name##_list_split_at(&a, &n[9], &b); \
+  err |= CHECK(name, &a, len, "0123456789"); \
+  err |= CHECK(name, &b, len, ""); \
+  name##_list_split_at(&a, &n[6], &b); \
+  err |= CHECK(name, &a, len, "0123456"); \
+  err |= CHECK(name, &b, len, "789"); \
+  name##_list_splice(&a, &b); \
+  err |= CHECK(name, &a, len, "7890123456"); \
+  err |= CHECK(name, &b, len, ""); \
+  name##_list_splice(&a, &b); \
+  err |= CHECK(name, &a, len, "7890123456"); \
+  name##_list_move_all(&b, &a); \
+  err |= CHECK(name, &a, len, ""); \
+  err |= CHECK(name, &b, len, "7890123456"); \
+  name##_list_concat(&a, &b); \
+  err |= CHECK(name, &a, len, "7890123456"); \
+  name##_list_splice(&b, &a); \
+  err |= CHECK(name, &a, len, ""); \
+  err |= CHECK(name, &b, len, "7890123456"); \
+  name##_list_split_at(&b, &n[0], &a); \
+  err |= CHECK(name, &b, len, "7890"); \
+  err |= CHECK(name, &a, len, "123456"); \
+  return err; \
+}
+#define CHECK(name, h, len, ids) \
+  check(#name, (h)->first, (h)->last, len(h), ids)
+
+DEFINE_OPS_CHECK(node, NOLEN)
+DEFINE_OPS_CHECK(lnode, lnode_list_len)
+
 void print_node(struct my_node *n) {
   printf("n: %p, next: %p\n",
           (void*)&n->links, (void*)n->links.next);
@@ -54,9 +129,13 @@ int main() {
     print_node(entry);
   }
 
+  // the list operations, checked on both lists
+  i = node_ops_check(nodes) | lnode_ops_check(nodes);
+  printf("list ops: %s\n", i ? "failed" : "ok");
+
   free(head);
   free(nodes);
 
-  return 0;
+  return i;
 }
 
@@ -0,0 +1,111 @@
+#include <stdio.h>            // printf
+#include "fcl_allocator.h"
+#include "fcl_list.h"
+#include "fcl_list_idx.h"
+
+#define NUM_NODES 1000
+
+// the free list link is only used while a node is in the allocator, and the
+// index links only while it is borrowed, so they share storage
+struct my_node {
+  uint32_t id;
+  union {
+    struct fcl_list_link flink;
+    struct fcl_list_idx_links links;
+  };
+};
+
+// the same node with pointer links, for comparison
+struct my_fat_node {
+  uint32_t id;
+  struct fcl_list_links links;
+};
+
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_link, flink,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_link, flink,
+                        LIFO)
+FCL_LIST_IDX_DL_DECLARE(node, struct my_node, links)
+FCL_LIST_IDX_DL_DEFINE(node, struct my_node, links)
+
+void sum_ids(struct my_node *n, void *ctx) {
+  *(uint64_t*)ctx += n->id;
+}
+
+int cmp_ids(struct my_node *a, struct my_node *b) {
+  return (a->id > b->id) - (a->id < b->id);
+}
+
+int main() {
+  struct node_allocator alloc;
+  struct node_list_head even, odd;
+  struct my_node *nodes[NUM_NODES], *i, *tmp, *base;
+  uint64_t sum = 0;
+  uint32_t k, n, prev;
+
+  printf("node size: %zu bytes with index links, %zu with pointer links\n",
+         sizeof(struct my_node), sizeof(struct my_fat_node));
+
+  // the ERROR oom policy keeps every node in the single initial slab
+  if (node_allocator_init(&alloc, NUM_NODES, FCL_ALLOCATOR_OOM_POLICY_ERROR,
+                          0, NULL) != 1)
+    return 1;
+  base = FCL_LIST_IDX_POOL_BASE(&alloc, struct my_node);
+  if (!base)
+    return 1;
+  node_list_head_init(&even, base);
+  node_list_head_init(&odd, base);
+
+  for (k=0; k < NUM_NODES; k++) {
+    nodes[k] = node_allocator_borrow(&alloc);
+    nodes[k]->id = k;
+    node_list_insert_tail(k % 2 ? &odd : &even, nodes[k]);
+  }
+
+  // move every multiple of 3 from the even list to the front of the odd list
+  FCL_LIST_IDX_DL_EACH(node, &even, i, tmp) {
+    if (i->id % 3 == 0) {
+      node_list_remove(&even, i);
+      node_list_insert_head(&odd, i);
+    }
+  }
+  node_list_concat(&even, &odd);
+  if (!node_list_is_empty(&odd))
+    return 1;
+
+  // walk backwards and check the links agree in both directions
+  for (i = node_list_get_last(&even), n = 0; i;
+       i = node_list_get_prev(&even, i), n++) {
+    prev = i->links.prev;
+    if (prev && node_list_get_next(&even, node_list_get_entry(&even, prev))
+        != i)
+      return 1;
+  }
+  node_list_for_each(&even, sum_ids, &sum);
+  printf("%u nodes, id sum %llu\n", n, (unsigned long long)sum);
+  if (n != NUM_NODES || sum != (uint64_t)NUM_NODES * (NUM_NODES - 1) / 2)
+    return 1;
+
+  // split off the second half, put it in front and sort the whole list back
+  node_list_split_at(&even, node_list_get_entry(&even, 1 + NUM_NODES / 2),
+                     &odd);
+  node_list_splice(&even, &odd);
+  node_list_sort(&even, cmp_ids);
+  for (i = node_list_get_first(&even), k = 0; i;
+       i = node_list_get_next(&even, i), k++)
+    if (i->id != k)
+      return 1;
+  if (k != NUM_NODES || node_list_get_last(&even)->id != NUM_NODES - 1 ||
+      node_list_get_prev(&even, node_list_get_last(&even))->id !=
+      NUM_NODES - 2)
+    return 1;
+  printf("sorted %u nodes after split_at and splice\n", k);
+
+  FCL_LIST_IDX_DL_EACH(node, &even, i, tmp) {
+    node_list_remove(&even, i);
+    node_allocator_return(&alloc, i);
+  }
+  node_allocator_freeall(&alloc);
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>            // printf
+#include <pthread.h>          // pthread_create
+#include "fcl_allocator.h"
+#include "fcl_list_atomic.h"
+
+#define NUM_PRODUCERS 4
+#define NODES_PER_PRODUCER 100000
+#define DRAIN_BATCH 64
+
+struct my_node {
+  int id;
+  int priority;
+  struct fcl_list_link link;
+};
+
+// the consumer owns the allocator, producers hand nodes over the queue
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_link, link,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_link, link,
+                        LIFO)
+
+FCL_LIST_MPSC_DECLARE(node, struct my_node, struct fcl_list_link, link)
+FCL_LIST_MPSC_DEFINE(node, struct my_node, struct fcl_list_link, link)
+
+struct node_mpsc_head queue;
+
+// function declarations
+void *producer(void *arg);
+
+int main() {
+  struct node_allocator node_alloc;
+  static struct my_node *nodes[NUM_PRODUCERS][NODES_PER_PRODUCER];
+  struct my_node *batch[DRAIN_BATCH];
+  pthread_t threads[NUM_PRODUCERS];
+  size_t i, n, received;
+  long sum, expected;
+  int p;
+
+  if (node_allocator_init(&node_alloc, NUM_PRODUCERS * NODES_PER_PRODUCER,
+                          FCL_ALLOCATOR_OOM_POLICY_ERROR, 0, NULL) != 1)
+    return 1;
+  node_mpsc_head_init(&queue);
+
+  expected = 0;
+  for (p=0; p < NUM_PRODUCERS; p++) {
+    for (i=0; i < NODES_PER_PRODUCER; i++) {
+      nodes[p][i] = node_allocator_borrow(&node_alloc);
+      nodes[p][i]->id = i;
+      nodes[p][i]->priority = p;
+      expected += i;
+    }
+  }
+  for (p=0; p < NUM_PRODUCERS; p++)
+    pthread_create(&threads[p], NULL, producer, nodes[p]);
+
+  // the single consumer drains in batches and recycles the nodes
+  received = 0;
+  sum = 0;
+  while (received < NUM_PRODUCERS * NODES_PER_PRODUCER) {
+    n = node_mpsc_drain(&queue, batch, DRAIN_BATCH);
+    for (i=0; i < n; i++) {
+      sum += batch[i]->id;
+      node_allocator_return(&node_alloc, batch[i]);
+    }
+    received += n;
+  }
+
+  for (p=0; p < NUM_PRODUCERS; p++)
+    pthread_join(threads[p], NULL);
+
+  printf("received: %zu, checksum %s\n", received,
+         sum == expected ? "ok" : "MISMATCH");
+  printf("allocator: free: %zu total: %zu\n", node_alloc.free_count,
+         node_alloc.total_count);
+  node_allocator_freeall(&node_alloc);
+
+  return sum == expected ? 0 : 1;
+}
+
+void *producer(void *arg) {
+  struct my_node **nodes = arg;
+  int i;
+
+  for (i=0; i < NODES_PER_PRODUCER; i++)
+    node_mpsc_push(&queue, nodes[i]);
+
+  return NULL;
+}
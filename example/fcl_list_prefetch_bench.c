@@ -0,0 +1,121 @@
+#include <stdint.h>           // uint64_t
+#include <stdio.h>            // snprintf
+#include <stdlib.h>           // malloc
+#include "fcl_allocator.h"
+#include "fcl_list.h"
+#include "fcl_bench.h"
+
+#define DEFAULT_SIZE 500000
+#define PAYLOAD_LINES 3
+
+// the link shares the first cache line with the key, the payload fills two
+// more lines
+struct my_node {
+  struct fcl_list_links links;
+  uint64_t key;
+  uint64_t payload[2 * LEVEL1_DCACHE_LINESIZE / sizeof(uint64_t)];
+};
+
+FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_links, links,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_links, links,
+                        LIFO)
+
+// the same nodes are on either a FIFO list or a DL list
+FCL_LIST_FIFO_DECLARE(fifo, struct my_node, struct fcl_list_links, links)
+FCL_LIST_FIFO_DEFINE(fifo, struct my_node, struct fcl_list_links, links)
+FCL_LIST_DL_DECLARE(dl, struct my_node, links)
+FCL_LIST_DL_DEFINE(dl, struct my_node, links)
+
+struct ctx {
+  struct fifo_list_head fifo;
+  struct fcl_list_links dl;
+  size_t dist;
+  size_t payload_lines;
+  uint64_t sum;
+};
+
+// function declarations
+void visit(struct my_node *n, void *arg);
+void scan_fifo(void *arg);
+void scan_dl(void *arg);
+void scan_dl_each(void *arg);
+
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  static const size_t dists[] = { 0, 1, 2, 4, 8, 16, 32 };
+  struct node_allocator alloc;
+  struct my_node **nodes;
+  struct ctx c;
+  char name[64];
+  size_t i, d;
+
+  fcl_bench_init(&b, argc, argv, DEFAULT_SIZE);
+  nodes = malloc(sizeof(*nodes) * b.size);
+  if (!nodes || !b.size)
+    return 1;
+  node_allocator_init(&alloc, b.size, FCL_ALLOCATOR_OOM_POLICY_ERROR, 0,
+                      NULL);
+  node_allocator_borrow_bulk(&alloc, nodes, b.size);
+  for (i=0; i < b.size; i++) {
+    nodes[i]->key = i;
+    nodes[i]->payload[0] = i;
+    nodes[i]->payload[LEVEL1_DCACHE_LINESIZE / sizeof(uint64_t)] = i;
+  }
+
+  // link the nodes in shuffled order so every hop is a likely cache miss
+  fcl_bench_shuffle(nodes, b.size, sizeof(*nodes), 1);
+  fifo_list_head_init(&c.fifo);
+  for (i=0; i < b.size; i++)
+    fifo_list_insert(&c.fifo, nodes[i]);
+  for (d=0; d < sizeof(dists) / sizeof(dists[0]); d++) {
+    c.dist = dists[d];
+    c.payload_lines = 0;
+    snprintf(name, sizeof(name), "fifo_for_each_d%zu", c.dist);
+    fcl_bench_run(&b, name, b.size, NULL, scan_fifo, &c);
+    c.payload_lines = PAYLOAD_LINES;
+    snprintf(name, sizeof(name), "fifo_for_each_payload_d%zu", c.dist);
+    fcl_bench_run(&b, name, b.size, NULL, scan_fifo, &c);
+  }
+
+  fcl_list_dl_init(&c.dl);
+  for (i=0; i < b.size; i++)
+    dl_list_insert_tail(&c.dl, nodes[i]);
+  for (d=0; d < sizeof(dists) / sizeof(dists[0]); d++) {
+    c.dist = dists[d];
+    c.payload_lines = PAYLOAD_LINES;
+    snprintf(name, sizeof(name), "dl_for_each_payload_d%zu", c.dist);
+    fcl_bench_run(&b, name, b.size, NULL, scan_dl, &c);
+    snprintf(name, sizeof(name), "dl_each_prefetch_d%zu", c.dist);
+    fcl_bench_run(&b, name, b.size, NULL, scan_dl_each, &c);
+  }
+  fcl_bench_finish(&b);
+
+  node_allocator_freeall(&alloc);
+  free(nodes);
+
+  return c.sum == 0;
+}
+
+void visit(struct my_node *n, void *arg) {
+  struct ctx *c = arg;
+  c->sum += n->key + n->payload[0] +
+            n->payload[LEVEL1_DCACHE_LINESIZE / sizeof(uint64_t)];
+}
+
+void scan_fifo(void *arg) {
+  struct ctx *c = arg;
+  fifo_list_for_each_prefetch(&c->fifo, visit, c, c->dist, c->payload_lines);
+}
+
+void scan_dl(void *arg) {
+  struct ctx *c = arg;
+  dl_list_for_each_prefetch(&c->dl, visit, c, c->dist, c->payload_lines);
+}
+
+void scan_dl_each(void *arg) {
+  struct ctx *c = arg;
+  struct fcl_list_links *i, *tmp, *ahead;
+  FCL_LIST_DL_EACH_PREFETCH(&c->dl, i, tmp, ahead, c->dist)
+    visit(dl_list_get_entry(i), c);
+}
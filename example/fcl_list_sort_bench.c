@@ -0,0 +1,134 @@
+#include <stdint.h>           // uint64_t
+#include <stdlib.h>           // qsort
+#include <string.h>           // memcpy
+#include "fcl_list.h"
+#include "fcl_bench.h"
+
+#define DEFAULT_SIZE 1000000
+
+struct my_node {
+  int id;
+  int priority;
+  struct fcl_list_link link;
+  struct fcl_list_links links;
+};
+
+FCL_LIST_FIFO_DECLARE(fifo, struct my_node, struct fcl_list_link, link)
+FCL_LIST_FIFO_DEFINE(fifo, struct my_node, struct fcl_list_link, link)
+FCL_LIST_DL_DECLARE(dl, struct my_node, links)
+FCL_LIST_DL_DEFINE(dl, struct my_node, links)
+
+struct ctx {
+  size_t n;
+  struct my_node **shuffled;
+  struct my_node **array;
+  struct fifo_list_head fifo;
+  struct fifo_list_head half;
+  struct fcl_list_links dl;
+};
+
+// function declarations
+int node_cmp(struct my_node *a, struct my_node *b);
+int node_ptr_cmp(const void *a, const void *b);
+void setup_fifo(void *arg);
+void sort_fifo(void *arg);
+void setup_halves(void *arg);
+void merge_fifo(void *arg);
+void setup_dl(void *arg);
+void sort_dl(void *arg);
+void setup_array(void *arg);
+void sort_array(void *arg);
+
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  struct my_node *nodes;
+  struct ctx c;
+  uint64_t seed = 7;
+  size_t i;
+
+  fcl_bench_init(&b, argc, argv, DEFAULT_SIZE);
+  c.n = b.size;
+  nodes = malloc(sizeof(*nodes) * c.n);
+  c.shuffled = malloc(sizeof(*c.shuffled) * c.n);
+  c.array = malloc(sizeof(*c.array) * c.n);
+  if (!nodes || !c.shuffled || !c.array)
+    return 1;
+  for (i=0; i < c.n; i++) {
+    nodes[i].id = i;
+    nodes[i].priority = fcl_bench_rand(&seed) % (c.n / 4 + 1);
+    c.shuffled[i] = &nodes[i];
+  }
+  fcl_bench_shuffle(c.shuffled, c.n, sizeof(*c.shuffled), seed);
+
+  fcl_bench_run(&b, "fifo_sort", c.n, setup_fifo, sort_fifo, &c);
+  fcl_bench_run(&b, "dl_sort", c.n, setup_dl, sort_dl, &c);
+  fcl_bench_run(&b, "qsort_ptrs", c.n, setup_array, sort_array, &c);
+  fcl_bench_run(&b, "fifo_merge_sorted", c.n, setup_halves, merge_fifo, &c);
+  fcl_bench_finish(&b);
+
+  free(c.array);
+  free(c.shuffled);
+  free(nodes);
+
+  return 0;
+}
+
+int node_cmp(struct my_node *a, struct my_node *b) {
+  return (a->priority > b->priority) - (a->priority < b->priority);
+}
+
+int node_ptr_cmp(const void *a, const void *b) {
+  return node_cmp(*(struct my_node * const *)a, *(struct my_node * const *)b);
+}
+
+void setup_fifo(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  fifo_list_head_init(&c->fifo);
+  for (i=0; i < c->n; i++)
+    fifo_list_insert(&c->fifo, c->shuffled[i]);
+}
+
+void sort_fifo(void *arg) {
+  struct ctx *c = arg;
+  fifo_list_sort(&c->fifo, node_cmp);
+}
+
+void setup_halves(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  fifo_list_head_init(&c->fifo);
+  fifo_list_head_init(&c->half);
+  for (i=0; i < c->n; i++)
+    fifo_list_insert(i % 2 ? &c->fifo : &c->half, c->shuffled[i]);
+  fifo_list_sort(&c->fifo, node_cmp);
+  fifo_list_sort(&c->half, node_cmp);
+}
+
+void merge_fifo(void *arg) {
+  struct ctx *c = arg;
+  fifo_list_merge_sorted(&c->fifo, &c->half, node_cmp);
+}
+
+void setup_dl(void *arg) {
+  struct ctx *c = arg;
+  size_t i;
+  fcl_list_dl_init(&c->dl);
+  for (i=0; i < c->n; i++)
+    dl_list_insert_tail(&c->dl, c->shuffled[i]);
+}
+
+void sort_dl(void *arg) {
+  struct ctx *c = arg;
+  dl_list_sort(&c->dl, node_cmp);
+}
+
+void setup_array(void *arg) {
+  struct ctx *c = arg;
+  memcpy(c->array, c->shuffled, sizeof(*c->array) * c->n);
+}
+
+void sort_array(void *arg) {
+  struct ctx *c = arg;
+  qsort(c->array, c->n, sizeof(*c->array), node_ptr_cmp);
+}
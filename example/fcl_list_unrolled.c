@@ -0,0 +1,72 @@
+#include <stdint.h>           // uint32_t
+#include <stdio.h>            // printf
+#include "fcl_list_unrolled.h"
+
+#define NUM_IDS 100000
+
+// a list of plain uint32_t values stored in two cache line chunks
+FCL_LIST_UNROLLED_DECLARE(ids, uint32_t)
+FCL_LIST_UNROLLED_DEFINE(ids, uint32_t)
+
+int main() {
+  struct ids_unrolled_chunk_allocator alloc;
+  struct ids_unrolled list;
+  struct ids_unrolled_chunk *c;
+  uint32_t batch[1000], v;
+  uint64_t sum, expect;
+  size_t i, chunks;
+
+  printf("chunk: %zu bytes, %zu ids\n", sizeof(struct ids_unrolled_chunk),
+         (size_t)FCL_LIST_UNROLLED_CAPACITY(uint32_t));
+  ids_unrolled_chunk_allocator_init(&alloc, 1024,
+                                    FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0, NULL);
+  ids_unrolled_init(&list, &alloc);
+
+  // append one at a time, then in bulk
+  for (i=0; i < NUM_IDS / 2; i++)
+    ids_unrolled_append(&list, i);
+  for (; i < NUM_IDS; i += v) {
+    for (v=0; v < 1000 && i + v < NUM_IDS; v++)
+      batch[v] = i + v;
+    ids_unrolled_append_bulk(&list, batch, v);
+  }
+
+  // a full scan streams through each chunk
+  sum = chunks = 0;
+  FCL_LIST_UNROLLED_EACH(ids, &list, c, i)
+    sum += c->elems[i];
+  FCL_LIST_UNROLLED_EACH(ids, &list, c, i)
+    if (i == 0)
+      chunks++;
+  expect = (uint64_t)NUM_IDS * (NUM_IDS - 1) / 2;
+  printf("count: %zu, chunks: %zu, sum: %llu\n", ids_unrolled_count(&list),
+         chunks, (unsigned long long)sum);
+  if (sum != expect)
+    return 1;
+
+  // inserting into a full chunk splits it
+  ids_unrolled_insert_at(&list, 5, 1000000);
+  ids_unrolled_insert_at(&list, 0, 2000000);
+  if (*ids_unrolled_at(&list, 0) != 2000000 ||
+      *ids_unrolled_at(&list, 6) != 1000000 ||
+      *ids_unrolled_at(&list, 7) != 5)
+    return 1;
+  ids_unrolled_remove_at(&list, 6, &v);
+  ids_unrolled_remove_at(&list, 0, NULL);
+  if (v != 1000000 || ids_unrolled_count(&list) != NUM_IDS)
+    return 1;
+
+  // removing every element from the front releases every chunk
+  for (i=0; ids_unrolled_remove_at(&list, 0, &v) == 1; i++)
+    if (v != i)
+      return 1;
+  printf("removed: %zu, allocator free: %zu of %zu\n", i, alloc.free_count,
+         alloc.total_count);
+  if (alloc.free_count != alloc.total_count)
+    return 1;
+
+  ids_unrolled_clear(&list);
+  ids_unrolled_chunk_allocator_freeall(&alloc);
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include <stdint.h>           // uint64_t
+#include <stdio.h>            // printf
+#include "fcl_allocator.h"
+#include "fcl_lru.h"
+
+#define CAPACITY 1000
+#define NUM_LOOKUPS 100000
+
+struct obj {
+  uint64_t id;
+  unsigned char ref;
+  struct fcl_list_links links;  // allocator free list, or recency list
+  struct fcl_list_link hlink;   // hash chain
+};
+
+FCL_ALLOCATOR_LL_DECLARE(obj, struct obj, struct fcl_list_links, links, LIFO)
+FCL_ALLOCATOR_LL_DEFINE(obj, struct obj, struct fcl_list_links, links, LIFO)
+
+// an exact LRU cache and a CLOCK cache of the same objects
+FCL_LRU_DECLARE(lru, struct obj, uint64_t, links, hlink, id, fcl_hash_u64,
+                FCL_HASH_EQ)
+FCL_LRU_DEFINE(lru, struct obj, uint64_t, links, hlink, id, fcl_hash_u64,
+               FCL_HASH_EQ)
+FCL_LRU_CLOCK_DECLARE(clk, struct obj, uint64_t, links, hlink, id,
+                      fcl_hash_u64, FCL_HASH_EQ, ref)
+FCL_LRU_CLOCK_DEFINE(clk, struct obj, uint64_t, links, hlink, id,
+                     fcl_hash_u64, FCL_HASH_EQ, ref)
+
+// function declarations
+void evict(struct obj *o, void *ctx);
+uint64_t next_key(uint64_t *state);
+
+int main() {
+  struct obj_allocator alloc;
+  struct lru_lru lru;
+  struct clk_lru clk;
+  struct obj *o;
+  uint64_t key, state;
+  size_t i, lru_hits = 0, clk_hits = 0;
+
+  obj_allocator_init(&alloc, CAPACITY, FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0,
+                     NULL);
+  lru_lru_init(&lru, CAPACITY, evict, &alloc);
+  clk_lru_init(&clk, CAPACITY, evict, &alloc);
+
+  // look up keys with a skewed distribution, caching every miss
+  for (i=0, state=1; i < NUM_LOOKUPS; i++) {
+    key = next_key(&state);
+    if (lru_lru_find(&lru, key)) {
+      lru_hits++;
+    } else {
+      o = obj_allocator_borrow(&alloc);
+      o->id = key;
+      lru_lru_insert(&lru, o);
+    }
+    if (clk_lru_find(&clk, key)) {
+      clk_hits++;
+    } else {
+      o = obj_allocator_borrow(&alloc);
+      o->id = key;
+      clk_lru_insert(&clk, o);
+    }
+  }
+
+  printf("lru: %zu hits, %zu cached\n", lru_hits, lru_lru_count(&lru));
+  printf("clock: %zu hits, %zu cached\n", clk_hits, clk_lru_count(&clk));
+  if (lru_lru_count(&lru) != CAPACITY || clk_lru_count(&clk) != CAPACITY ||
+      alloc.total_count - alloc.free_count != 2 * CAPACITY)
+    return 1;
+
+  // the most recently used entry is at the head
+  o = lru_lru_peek(&lru, key);
+  if (!o || lru_lru_order_list_get_first(&lru.order) != o)
+    return 1;
+
+  // everything still cached is handed back to the allocator
+  lru_lru_freeall(&lru);
+  clk_lru_freeall(&clk);
+  printf("allocator free: %zu of %zu\n", alloc.free_count, alloc.total_count);
+  obj_allocator_freeall(&alloc);
+
+  return 0;
+}
+
+void evict(struct obj *o, void *ctx) {
+  obj_allocator_return(ctx, o);
+}
+
+// a key from 0..9999, 90% of the time from the first 500
+uint64_t next_key(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  if ((*state >> 33) % 10)
+    return (*state >> 40) % 500;
+  return (*state >> 40) % 10000;
+}
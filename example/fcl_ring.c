@@ -0,0 +1,164 @@
+#include <stdio.h>            // printf
+#include <pthread.h>          // pthread_create
+#include <sched.h>            // sched_yield
+#include <stdatomic.h>        // atomic_int
+#include "fcl_allocator.h"
+#include "fcl_ring.h"
+
+#define NUM_CONSUMERS 3
+#define POOL_SIZE 256
+#define NUM_MSGS 1000000
+#define BATCH 16
+
+struct msg {
+  long id;
+  long value;
+  struct fcl_list_link link;    // allocator free list
+};
+
+// the producer owns the allocator; messages travel through the rings by
+// pointer and come back to the producer on the recycle ring
+FCL_ALLOCATOR_LL_DECLARE(msg, struct msg, struct fcl_list_link, link, LIFO)
+FCL_ALLOCATOR_LL_DEFINE(msg, struct msg, struct fcl_list_link, link, LIFO)
+
+// producer -> parser
+FCL_RING_SPSC_DECLARE(msg, struct msg)
+FCL_RING_SPSC_DEFINE(msg, struct msg)
+// parser -> consumers, and consumers -> producer
+FCL_RING_MPMC_DECLARE(msg, struct msg)
+FCL_RING_MPMC_DEFINE(msg, struct msg)
+
+struct consumer {
+  pthread_t thread;
+  long sum;
+};
+
+struct msg_allocator msg_alloc;
+struct msg_ring_spsc in;
+struct msg_ring_mpmc work, recycle;
+struct consumer consumers[NUM_CONSUMERS];
+atomic_int done;
+
+// function declarations
+void *parser(void *arg);
+void *consumer(void *arg);
+long reclaim(void);
+
+int main() {
+  pthread_t parser_thread;
+  struct msg *batch[BATCH];
+  long i, sum, expected, returned = 0;
+  size_t n, k;
+  int c;
+
+  if (msg_allocator_init(&msg_alloc, POOL_SIZE,
+                         FCL_ALLOCATOR_OOM_POLICY_ERROR, 0, NULL) != 1 ||
+      msg_ring_spsc_init(&in, 64) != 1 ||
+      msg_ring_mpmc_init(&work, 64) != 1 ||
+      msg_ring_mpmc_init(&recycle, POOL_SIZE) != 1)
+    return 1;
+  atomic_init(&done, 0);
+  pthread_create(&parser_thread, NULL, parser, NULL);
+  for (c=0; c < NUM_CONSUMERS; c++) {
+    consumers[c].sum = 0;
+    pthread_create(&consumers[c].thread, NULL, consumer, &consumers[c]);
+  }
+
+  expected = 0;
+  for (i=0; i < NUM_MSGS; ) {
+    for (n=0; n < BATCH && i < NUM_MSGS; n++, i++) {
+      while (!(batch[n] = msg_allocator_borrow(&msg_alloc))) {
+        returned += reclaim();
+        sched_yield();
+      }
+      batch[n]->id = i;
+      expected += 2 * i;
+    }
+    for (k=0; k < n; ) {
+      k += msg_ring_spsc_enqueue_bulk(&in, &batch[k], n - k);
+      if (k < n)
+        sched_yield();
+    }
+  }
+  while (returned < NUM_MSGS) {
+    returned += reclaim();
+    sched_yield();
+  }
+  atomic_store(&done, 1);
+
+  pthread_join(parser_thread, NULL);
+  sum = 0;
+  for (c=0; c < NUM_CONSUMERS; c++) {
+    pthread_join(consumers[c].thread, NULL);
+    sum += consumers[c].sum;
+  }
+  printf("messages: %d, pool: %zu, free: %zu\n", NUM_MSGS,
+         msg_alloc.total_count, msg_alloc.free_count);
+  printf("sum: %ld, expected: %ld\n", sum, expected);
+  if (sum != expected || msg_alloc.free_count != POOL_SIZE)
+    return 1;
+  msg_ring_spsc_freeall(&in);
+  msg_ring_mpmc_freeall(&work);
+  msg_ring_mpmc_freeall(&recycle);
+  msg_allocator_freeall(&msg_alloc);
+
+  return 0;
+}
+
+// returns the messages the consumers are done with to the allocator
+long reclaim(void) {
+  struct msg *batch[BATCH];
+  size_t i, n;
+  long count = 0;
+
+  while ((n = msg_ring_mpmc_dequeue_bulk(&recycle, batch, BATCH))) {
+    for (i=0; i < n; i++)
+      msg_allocator_return(&msg_alloc, batch[i]);
+    count += n;
+  }
+  return count;
+}
+
+void *parser(void *arg) {
+  struct msg *batch[BATCH];
+  size_t i, n, k;
+
+  (void)arg;
+  while (!atomic_load(&done)) {
+    n = msg_ring_spsc_dequeue_bulk(&in, batch, BATCH);
+    if (!n) {
+      sched_yield();
+      continue;
+    }
+    for (i=0; i < n; i++)
+      batch[i]->value = 2 * batch[i]->id;
+    for (k=0; k < n; ) {
+      k += msg_ring_mpmc_enqueue_bulk(&work, &batch[k], n - k);
+      if (k < n)
+        sched_yield();
+    }
+  }
+  return NULL;
+}
+
+void *consumer(void *arg) {
+  struct consumer *self = arg;
+  struct msg *batch[BATCH];
+  size_t i, n, k;
+
+  while (!atomic_load(&done)) {
+    n = msg_ring_mpmc_dequeue_bulk(&work, batch, BATCH);
+    if (!n) {
+      sched_yield();
+      continue;
+    }
+    for (i=0; i < n; i++)
+      self->sum += batch[i]->value;
+    for (k=0; k < n; ) {
+      k += msg_ring_mpmc_enqueue_bulk(&recycle, &batch[k], n - k);
+      if (k < n)
+        sched_yield();
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>            // printf
+#include <pthread.h>          // pthread_mutex_lock
+#include "fcl_allocator.h"
+#include "fcl_list.h"
+#include "fcl_ring.h"
+#include "fcl_bench.h"
+
+#define DEFAULT_OPS 1000000
+#define BATCH 16
+
+struct msg {
+  long id;
+  struct fcl_list_link link;
+};
+
+FCL_ALLOCATOR_LL_DECLARE(msg, struct msg, struct fcl_list_link, link, LIFO)
+FCL_ALLOCATOR_LL_DEFINE(msg, struct msg, struct fcl_list_link, link, LIFO)
+FCL_LIST_FIFO_DECLARE(mq, struct msg, struct fcl_list_link, link)
+FCL_LIST_FIFO_DEFINE(mq, struct msg, struct fcl_list_link, link)
+FCL_RING_SPSC_DECLARE(msg, struct msg)
+FCL_RING_SPSC_DEFINE(msg, struct msg)
+FCL_RING_MPMC_DECLARE(msg, struct msg)
+FCL_RING_MPMC_DEFINE(msg, struct msg)
+
+struct ctx {
+  size_t n;
+  long sink;
+  struct msg *msgs[BATCH];
+  struct msg_ring_spsc spsc;
+  struct msg_ring_mpmc mpmc;
+  struct mq_list_head list;
+  pthread_mutex_t lock;
+};
+
+// every benchmark passes n messages through the queue, BATCH at a time, on
+// one thread; this measures the cost of the operations themselves, not the
+// cache line transfers between threads
+#define BENCH_RING(q) \
+void q##_single(void *arg) {  \
+  struct ctx *c = arg;  \
+  size_t i, j;  \
+  for (i=0; i < c->n; i += BATCH) { \
+    for (j=0; j < BATCH; j++) \
+      msg_ring_##q##_enqueue(&c->q, c->msgs[j]);  \
+    for (j=0; j < BATCH; j++) \
+      c->sink += msg_ring_##q##_dequeue(&c->q)->id; \
+  } \
+} \
+void q##_bulk(void *arg) {  \
+  struct ctx *c = arg;  \
+  size_t i; \
+  for (i=0; i < c->n; i += BATCH) { \
+    msg_ring_##q##_enqueue_bulk(&c->q, c->msgs, BATCH); \
+    msg_ring_##q##_dequeue_bulk(&c->q, c->msgs, BATCH); \
+    c->sink += c->msgs[0]->id;  \
+  } \
+}
+
+BENCH_RING(spsc)
+BENCH_RING(mpmc)
+
+void locked_list(void *arg) {
+  struct ctx *c = arg;
+  size_t i, j;
+  for (i=0; i < c->n; i += BATCH) {
+    for (j=0; j < BATCH; j++) {
+      pthread_mutex_lock(&c->lock);
+      mq_list_insert(&c->list, c->msgs[j]);
+      pthread_mutex_unlock(&c->lock);
+    }
+    for (j=0; j < BATCH; j++) {
+      pthread_mutex_lock(&c->lock);
+      c->sink += mq_list_remove(&c->list)->id;
+      pthread_mutex_unlock(&c->lock);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  static struct ctx c;
+  struct msg_allocator alloc;
+  int i;
+
+  fcl_bench_init(&b, argc, argv, DEFAULT_OPS);
+  c.n = b.size < BATCH ? BATCH : b.size / BATCH * BATCH;
+  c.sink = 0;
+  if (msg_allocator_init(&alloc, BATCH, FCL_ALLOCATOR_OOM_POLICY_ERROR, 0,
+                         NULL) != 1 ||
+      msg_ring_spsc_init(&c.spsc, 4 * BATCH) != 1 ||
+      msg_ring_mpmc_init(&c.mpmc, 4 * BATCH) != 1)
+    return 1;
+  mq_list_head_init(&c.list);
+  pthread_mutex_init(&c.lock, NULL);
+  for (i=0; i < BATCH; i++) {
+    c.msgs[i] = msg_allocator_borrow(&alloc);
+    c.msgs[i]->id = i;
+  }
+
+  fcl_bench_run(&b, "spsc_single", c.n, NULL, spsc_single, &c);
+  fcl_bench_run(&b, "spsc_bulk", c.n, NULL, spsc_bulk, &c);
+  fcl_bench_run(&b, "mpmc_single", c.n, NULL, mpmc_single, &c);
+  fcl_bench_run(&b, "mpmc_bulk", c.n, NULL, mpmc_bulk, &c);
+  fcl_bench_run(&b, "locked_fifo_list", c.n, NULL, locked_list, &c);
+  fcl_bench_finish(&b);
+
+  for (i=0; i < BATCH; i++)
+    msg_allocator_return(&alloc, c.msgs[i]);
+  msg_ring_spsc_freeall(&c.spsc);
+  msg_ring_mpmc_freeall(&c.mpmc);
+  msg_allocator_freeall(&alloc);
+  pthread_mutex_destroy(&c.lock);
+
+  return c.sink ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include <stdint.h>           // uint64_t
+#include <stdio.h>            // printf
+#include <stdlib.h>           // rand
+#include "fcl_allocator.h"
+#include "fcl_timer_wheel.h"
+
+#define NUM_CONNS 100000
+#define MAX_TIMEOUT (1 << 20)
+#define STEP 997
+
+struct conn {
+  int id;
+  uint64_t expires;
+  struct fcl_list_links tlinks; // allocator free list, or timer slot
+};
+
+FCL_ALLOCATOR_LL_DECLARE(conn, struct conn, struct fcl_list_links, tlinks,
+                         LIFO)
+FCL_ALLOCATOR_LL_DEFINE(conn, struct conn, struct fcl_list_links, tlinks,
+                        LIFO)
+
+FCL_TIMER_WHEEL_DECLARE(conn, struct conn, tlinks, expires)
+FCL_TIMER_WHEEL_DEFINE(conn, struct conn, tlinks, expires)
+
+int main() {
+  struct conn_allocator alloc;
+  struct conn_timer_wheel wheel;
+  struct conn *conns[NUM_CONNS], *c;
+  struct fcl_list_links expired, *iter, *tmp;
+  size_t i, armed = 0, fired = 0;
+  uint64_t now, prev;
+
+  srand(1);
+  conn_allocator_init(&alloc, NUM_CONNS, FCL_ALLOCATOR_OOM_POLICY_ERROR, 0,
+                      NULL);
+  conn_timer_wheel_init(&wheel, 1000);
+
+  for (i=0; i < NUM_CONNS; i++) {
+    conns[i] = conn_allocator_borrow(&alloc);
+    conns[i]->id = i;
+    conn_timer_wheel_arm(&wheel, conns[i], 1000 + 1 + rand() % MAX_TIMEOUT);
+    armed++;
+  }
+
+  // every third connection sees traffic and cancels its timeout
+  for (i=0; i < NUM_CONNS; i += 3) {
+    conn_timer_wheel_cancel(&wheel, conns[i]);
+    conn_allocator_return(&alloc, conns[i]);
+    armed--;
+  }
+  printf("armed: %zu\n", conn_timer_wheel_count(&wheel));
+
+  // advance in uneven steps; every timer fires within the step it is due
+  fcl_list_dl_init(&expired);
+  for (now = 1000; conn_timer_wheel_count(&wheel); ) {
+    prev = now;
+    now += STEP;
+    fired += conn_timer_wheel_advance(&wheel, now, &expired);
+    FCL_LIST_DL_EACH(&expired, iter, tmp) {
+      c = conn_timer_list_get_entry(iter);
+      if (c->expires <= prev || c->expires > now) {
+        printf("conn %d due %llu fired in (%llu, %llu]\n", c->id,
+               (unsigned long long)c->expires, (unsigned long long)prev,
+               (unsigned long long)now);
+        return 1;
+      }
+      conn_timer_list_remove(c);
+      conn_allocator_return(&alloc, c);
+    }
+  }
+  printf("fired: %zu by tick %llu\n", fired, (unsigned long long)now);
+  if (fired != armed || alloc.free_count != alloc.total_count)
+    return 1;
+
+  // a timer armed in the past fires on the next tick
+  c = conn_allocator_borrow(&alloc);
+  conn_timer_wheel_arm(&wheel, c, 0);
+  if (conn_timer_wheel_advance(&wheel, now + 1, &expired) != 1 ||
+      conn_timer_list_get_first(&expired) != c)
+    return 1;
+  conn_timer_list_remove(c);
+  conn_allocator_return(&alloc, c);
+
+  conn_allocator_freeall(&alloc);
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <stdio.h>            // printf
+#include <stdlib.h>           // abort
+#include "fcl_wsdeque_sched.h"
+
+#define NUM_WORKERS 4
+#define DEPTH 18
+
+// function declarations
+void tree_sum(struct sched_worker *w, struct task *t);
+
+int main() {
+  static struct sched s;
+  struct sched_worker *w;
+  long sum = 0, expected;
+  size_t executed = 0, steals = 0, total = 0, free_count = 0;
+  int i;
+
+  if (sched_init(&s, NUM_WORKERS) != 1)
+    return 1;
+  if (sched_run(&s, tree_sum, 1, DEPTH) != 1)
+    return 1;
+
+  for (i=0; i < NUM_WORKERS; i++) {
+    w = &s.workers[i];
+    printf("worker %d: executed: %zu, stolen: %zu, tasks: %zu\n", i,
+           w->executed, w->steals, w->alloc.total_count);
+    sum += w->sum;
+    executed += w->executed;
+    steals += w->steals;
+    total += w->alloc.total_count;
+    free_count += w->alloc.free_count;
+  }
+  // the leaves hold 2^DEPTH .. 2^(DEPTH+1) - 1
+  expected = ((1L << DEPTH) + (1L << (DEPTH + 1)) - 1) * (1L << DEPTH) / 2;
+  printf("tasks: %zu, stolen: %zu, sum: %ld, expected: %ld\n", executed,
+         steals, sum, expected);
+  // every task went back to the allocator it was borrowed from
+  if (sum != expected || executed != (2UL << DEPTH) - 1 ||
+      free_count != total)
+    return 1;
+  sched_destroy(&s);
+
+  return 0;
+}
+
+// a binary tree of tasks, summing the values of its leaves
+void tree_sum(struct sched_worker *w, struct task *t) {
+  struct task *child;
+  int i;
+
+  if (!t->depth) {
+    w->sum += t->arg;
+    return;
+  }
+  for (i=0; i < 2; i++) {
+    child = sched_task_new(w, tree_sum, 2 * t->arg + i, t->depth - 1);
+    if (!child)
+      abort();
+    sched_spawn(w, child);
+  }
+}
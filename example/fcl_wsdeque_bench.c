@@ -0,0 +1,61 @@
+#include <stdio.h>            // snprintf
+#include <stdlib.h>           // abort
+#include "fcl_wsdeque_sched.h"
+#include "fcl_bench.h"
+
+#define DEFAULT_SIZE (1 << 20)
+#define MAX_THREADS 8
+
+struct ctx {
+  struct sched s;
+  int depth;
+  long sum;
+};
+
+// function declarations
+void tree_sum(struct sched_worker *w, struct task *t);
+void run(void *arg);
+
+int main(int argc, char **argv) {
+  static struct fcl_bench b;
+  static struct ctx c;
+  char name[64];
+  int t;
+
+  // a binary tree of about b.size fine-grained tasks, each of which only
+  // adds to a sum or spawns two children
+  fcl_bench_init(&b, argc, argv, DEFAULT_SIZE);
+  for (c.depth = 0; (2UL << (c.depth + 1)) - 1 <= b.size; c.depth++)
+    ;
+  for (t = 1; t <= MAX_THREADS; t *= 2) {
+    if (sched_init(&c.s, t) != 1)
+      return 1;
+    snprintf(name, sizeof(name), "wsdeque_tree_t%d", t);
+    fcl_bench_run(&b, name, (2UL << c.depth) - 1, NULL, run, &c);
+    sched_destroy(&c.s);
+  }
+  fcl_bench_finish(&b);
+
+  return 0;
+}
+
+void run(void *arg) {
+  struct ctx *c = arg;
+  sched_run(&c->s, tree_sum, 1, c->depth);
+}
+
+void tree_sum(struct sched_worker *w, struct task *t) {
+  struct task *child;
+  int i;
+
+  if (!t->depth) {
+    w->sum += t->arg;
+    return;
+  }
+  for (i=0; i < 2; i++) {
+    child = sched_task_new(w, tree_sum, 2 * t->arg + i, t->depth - 1);
+    if (!child)
+      abort();
+    sched_spawn(w, child);
+  }
+}
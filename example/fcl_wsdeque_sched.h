@@ -0,0 +1,181 @@
+#ifndef _FCL_WSDEQUE_SCHED_H_
+#define _FCL_WSDEQUE_SCHED_H_
+
+/* A small reference work-stealing scheduler, shared by fcl_wsdeque.c and
+   fcl_wsdeque_bench.c.
+
+   Every worker owns an fcl_wsdeque of tasks and an allocator with a remote
+   free list (FCL_ALLOCATOR_LL_REMOTE_XXX) the tasks it spawns come from.
+   A worker runs its own tasks newest first and, when it has none, steals
+   the oldest task of a random victim.  A task that ran on another worker
+   is given back to its owner's allocator with
+   name##_allocator_return_remote.  The scheduler stops once every spawned
+   task has run.
+*/
+
+#include <stdint.h>           // uint64_t
+#include <pthread.h>          // pthread_create
+#include <sched.h>            // sched_yield
+#include <stdatomic.h>        // atomic_long
+#include "fcl_allocator.h"
+#include "fcl_wsdeque.h"
+
+#define SCHED_MAX_WORKERS 64
+#define SCHED_DEQUE_CAPACITY 4096
+#define SCHED_TASKS_PER_SLAB 1024
+
+struct sched_worker;
+
+struct task {
+  void (*fn)(struct sched_worker *w, struct task *t);
+  long arg;
+  int depth;
+  struct sched_worker *owner;
+  struct fcl_list_link link;  // allocator free lists
+};
+
+FCL_ALLOCATOR_LL_REMOTE_DECLARE(task, struct task, struct fcl_list_link, link,
+                                LIFO)
+FCL_ALLOCATOR_LL_REMOTE_DEFINE(task, struct task, struct fcl_list_link, link,
+                               LIFO)
+
+FCL_WSDEQUE_DECLARE(task, struct task)
+FCL_WSDEQUE_DEFINE(task, struct task)
+
+struct sched;
+
+struct sched_worker {
+  struct task_wsdeque deque;
+  struct task_allocator alloc;
+  struct sched *s;
+  pthread_t thread;
+  uint64_t seed;
+  long sum;
+  size_t executed;
+  size_t steals;
+};
+
+struct sched {
+  struct sched_worker workers[SCHED_MAX_WORKERS];
+  int num_workers;
+  atomic_long pending;
+};
+
+// xorshift64*, to pick steal victims
+static inline uint64_t sched_rand(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ull;
+}
+
+static inline int sched_init(struct sched *s, int num_workers) {
+  struct sched_worker *w;
+  int i;
+
+  if (num_workers < 1 || num_workers > SCHED_MAX_WORKERS)
+    return -1;
+  s->num_workers = num_workers;
+  atomic_init(&s->pending, 0);
+  for (i=0; i < num_workers; i++) {
+    w = &s->workers[i];
+    w->s = s;
+    w->seed = 0x9e3779b97f4a7c15ull * (i + 1);
+    w->sum = 0;
+    w->executed = w->steals = 0;
+    if (task_wsdeque_init(&w->deque, SCHED_DEQUE_CAPACITY) != 1 ||
+        task_allocator_init(&w->alloc, SCHED_TASKS_PER_SLAB,
+                            FCL_ALLOCATOR_OOM_POLICY_DOUBLE, 0, NULL) != 1)
+      return -1;
+  }
+  return 1;
+}
+
+static inline void sched_destroy(struct sched *s) {
+  int i;
+  for (i=0; i < s->num_workers; i++) {
+    task_wsdeque_freeall(&s->workers[i].deque);
+    task_allocator_freeall(&s->workers[i].alloc);
+  }
+}
+
+static inline struct task *sched_task_new(struct sched_worker *w,
+    void (*fn)(struct sched_worker *, struct task *), long arg, int depth) {
+  struct task *t = task_allocator_borrow(&w->alloc);
+  if (!t)
+    return NULL;
+  t->fn = fn;
+  t->arg = arg;
+  t->depth = depth;
+  t->owner = w;
+  return t;
+}
+
+static inline void sched_task_run(struct sched_worker *w, struct task *t) {
+  t->fn(w, t);
+  w->executed++;
+  if (t->owner == w)
+    task_allocator_return(&w->alloc, t);
+  else
+    task_allocator_return_remote(&t->owner->alloc, t);
+  // only after the task spawned its children, so pending never drops to 0
+  // while work remains
+  atomic_fetch_sub_explicit(&w->s->pending, 1, memory_order_release);
+}
+
+// makes @t runnable; runs it right away if the deque is full
+static inline void sched_spawn(struct sched_worker *w, struct task *t) {
+  atomic_fetch_add_explicit(&w->s->pending, 1, memory_order_relaxed);
+  if (task_wsdeque_push(&w->deque, t) != 1)
+    sched_task_run(w, t);
+}
+
+static inline void *sched_worker_loop(void *arg) {
+  struct sched_worker *w = arg, *victim;
+  struct task *t;
+  struct sched *s = w->s;
+  int i;
+
+  for (;;) {
+    while ((t = task_wsdeque_pop(&w->deque)))
+      sched_task_run(w, t);
+    for (i=0, t = NULL; i < s->num_workers && !t; i++) {
+      victim = &s->workers[sched_rand(&w->seed) % s->num_workers];
+      if (victim != w)
+        t = task_wsdeque_steal(&victim->deque);
+    }
+    if (t) {
+      w->steals++;
+      sched_task_run(w, t);
+    } else if (!atomic_load_explicit(&s->pending, memory_order_acquire)) {
+      break;
+    } else {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+// runs the task tree rooted at a task of @fn on every worker, the caller
+// acting as worker 0, and returns once every spawned task has run
+static inline int sched_run(struct sched *s,
+    void (*fn)(struct sched_worker *, struct task *), long arg, int depth) {
+  struct task *root;
+  int i;
+
+  root = sched_task_new(&s->workers[0], fn, arg, depth);
+  if (!root)
+    return -1;
+  sched_spawn(&s->workers[0], root);
+  for (i=1; i < s->num_workers; i++)
+    pthread_create(&s->workers[i].thread, NULL, sched_worker_loop,
+                   &s->workers[i]);
+  sched_worker_loop(&s->workers[0]);
+  for (i=1; i < s->num_workers; i++)
+    pthread_join(s->workers[i].thread, NULL);
+  for (i=0; i < s->num_workers; i++)
+    task_allocator_reclaim(&s->workers[i].alloc);
+  return 1;
+}
+
+#endif  // _FCL_WSDEQUE_SCHED_H_
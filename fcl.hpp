@@ -0,0 +1,577 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only C++ front end for the fcl lists and allocator.
+   Requires C++11.
+   This library is NOT thread safe.
+
+   The C macros emit external-linkage functions, so each FCL_XXX_DEFINE must
+   be instantiated in exactly one translation unit.  The templates here
+   instead take the container type and its link member as template
+   arguments, and every member function is defined in the class, so nothing
+   has to be instantiated by hand and every call can be inlined.  They
+   operate on the same fcl_list_link(s) structs and head layouts as the C
+   macros, so an object and a list head can be shared with C code using
+   FCL_LIST_DL_XXX or FCL_LIST_FIFO_XXX on the same fields.
+
+   fcl::intrusive_list<T, &T::links> is an FCL_LIST_DL list: a circular
+   fcl_list_links sentinel with bidirectional iterators.
+   fcl::intrusive_slist<T, &T::link> is an FCL_LIST_FIFO list (first, last)
+   with forward iterators.  Both are non-owning like their C counterparts,
+   and their iterators satisfy the standard iterator requirements, so
+   std::find_if, std::count_if, range for and the like work on them.
+   Neither keeps a length; size() walks the list.
+
+   fcl::pool<T, Policy, Init> is an FCL_ALLOCATOR_LL of T sized slots.  It
+   expands the same macro as FCL_ALLOCATOR_LL_DEFINE_STATIC, with the
+   functions as static members of a class template, so the pool is a thin
+   wrapper around the C functions and behaves exactly like them: the slabs,
+   backends, carving, growth, element init policies, trim and statistics
+   are those of fcl_allocator.h.  The policy is a type, eg
+   fcl::pool_policy<fifo, oom_policy>, fixed at compile time, and selects
+   one of the specializations generated with a fixed oom policy, so the
+   growth check compiles to straight line code.  Free slots are linked
+   through their own storage, so T needs no link member of its own; with an
+   Init callback each slot carries a link after the object instead, so the
+   free list does not overwrite what Init wrote.
+   borrow() and give_back() hand out raw storage like name##_allocator_borrow
+   and _return; make() and destroy() also run the constructor and
+   destructor, and make_unique() returns a std::unique_ptr that gives the
+   object back when it goes out of scope.  The pool releases its slabs when
+   it is destroyed; objects still borrowed then are not destructed.
+*/
+
+#ifndef _FCL_HPP_
+#define _FCL_HPP_
+
+#include <cassert>      // assert
+#include <cstddef>      // size_t, ptrdiff_t
+#include <cstdint>      // uintptr_t
+#include <cstring>      // memcpy
+#include <iterator>     // iterator tags
+#include <memory>       // unique_ptr
+#include <new>          // placement new, bad_alloc
+#include <type_traits>  // conditional, enable_if, is_trivially_copyable
+#include <utility>      // forward
+#include "fcl_allocator.h"
+#include "fcl_list.h"
+
+namespace fcl {
+
+namespace detail {
+
+// the C++ counterpart of FCL_CONTAINER_OF for a pointer to member.  The
+// offset folds to a constant when optimizing.
+template <typename T, typename L>
+inline std::size_t member_offset(L T::*member) {
+  const std::uintptr_t fake = alignof(T) * 64;
+  return reinterpret_cast<std::uintptr_t>(
+      &(reinterpret_cast<T*>(fake)->*member)) - fake;
+}
+
+template <typename T, typename L>
+inline T *container_of(L *l, L T::*member) {
+  return reinterpret_cast<T*>(reinterpret_cast<char*>(l) -
+                              member_offset(member));
+}
+
+}  // namespace detail
+
+
+// an FCL_LIST_DL list of T, linked through the fcl_list_links Links
+template <typename T, fcl_list_links T::*Links>
+class intrusive_list {
+ public:
+  template <bool Const>
+  class iter {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef typename std::conditional<Const, const T*, T*>::type pointer;
+    typedef typename std::conditional<Const, const T&, T&>::type reference;
+
+    iter() : l_(nullptr) {}
+    explicit iter(fcl_list_links *l) : l_(l) {}
+    // iterator converts to const_iterator
+    template <bool C, typename = typename std::enable_if<Const && !C>::type>
+    iter(const iter<C> &o) : l_(o.link()) {}
+
+    reference operator*() const { return *detail::container_of(l_, Links); }
+    pointer operator->() const { return detail::container_of(l_, Links); }
+    iter &operator++() { l_ = l_->next; return *this; }
+    iter operator++(int) { iter t = *this; l_ = l_->next; return t; }
+    iter &operator--() { l_ = l_->prev; return *this; }
+    iter operator--(int) { iter t = *this; l_ = l_->prev; return t; }
+    bool operator==(const iter &o) const { return l_ == o.l_; }
+    bool operator!=(const iter &o) const { return l_ != o.l_; }
+    fcl_list_links *link() const { return l_; }
+
+   private:
+    fcl_list_links *l_;
+  };
+
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef iter<false> iterator;
+  typedef iter<true> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  intrusive_list() { fcl_list_dl_init(&head_); }
+  intrusive_list(const intrusive_list&) = delete;
+  intrusive_list &operator=(const intrusive_list&) = delete;
+  // the elements point at the sentinel, so moving relinks the ends
+  intrusive_list(intrusive_list &&o) {
+    fcl_list_dl_init(&head_);
+    splice(end(), o);
+  }
+  intrusive_list &operator=(intrusive_list &&o) {
+    clear();
+    splice(end(), o);
+    return *this;
+  }
+
+  // the raw sentinel, for use with the C FCL_LIST_DL functions
+  fcl_list_links *head() { return &head_; }
+
+  iterator begin() { return iterator(head_.next); }
+  iterator end() { return iterator(&head_); }
+  const_iterator begin() const { return const_iterator(head_.next); }
+  const_iterator end() const { return const_iterator(sentinel()); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  bool empty() const { return head_.next == &head_; }
+  size_type size() const {
+    size_type n = 0;
+    for (const fcl_list_links *i = head_.next; i != &head_; i = i->next)
+      n++;
+    return n;
+  }
+  T &front() { assert(!empty()); return *begin(); }
+  T &back() { assert(!empty()); return *iterator(head_.prev); }
+
+  // inserts e before pos, returns an iterator to e
+  iterator insert(iterator pos, T &e) {
+    fcl_list_links *n = &(e.*Links), *next = pos.link();
+    n->next = next;
+    n->prev = next->prev;
+    next->prev->next = n;
+    next->prev = n;
+    return iterator(n);
+  }
+  void push_front(T &e) { insert(begin(), e); }
+  void push_back(T &e) { insert(end(), e); }
+
+  // unlinks the element at pos, returns an iterator to the next one
+  iterator erase(iterator pos) {
+    assert(pos != end());
+    fcl_list_links *n = pos.link(), *next = n->next;
+    unlink(n);
+    return iterator(next);
+  }
+  // unlinks e from whichever list it is on
+  static void remove(T &e) { unlink(&(e.*Links)); }
+  void pop_front() { erase(begin()); }
+  void pop_back() { erase(iterator(head_.prev)); }
+
+  // moves every element of src in front of pos in O(1)
+  void splice(iterator pos, intrusive_list &src) {
+    if (src.empty())
+      return;
+    fcl_list_links *first = src.head_.next, *last = src.head_.prev;
+    fcl_list_links *next = pos.link(), *prev = next->prev;
+    prev->next = first;
+    first->prev = prev;
+    last->next = next;
+    next->prev = last;
+    fcl_list_dl_init(&src.head_);
+  }
+
+  // unlinks every element, which remain owned by the caller
+  void clear() {
+    fcl_list_links *i = head_.next, *next;
+    for (; i != &head_; i = next) {
+      next = i->next;
+      i->next = i->prev = nullptr;
+    }
+    fcl_list_dl_init(&head_);
+  }
+
+  iterator iterator_to(T &e) { return iterator(&(e.*Links)); }
+
+ private:
+  static void unlink(fcl_list_links *n) {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    n->next = n->prev = nullptr;
+  }
+  fcl_list_links *sentinel() const {
+    return const_cast<fcl_list_links*>(&head_);
+  }
+
+  fcl_list_links head_;
+};
+
+
+// an FCL_LIST_FIFO list of T, linked through the fcl_list_link Link
+template <typename T, fcl_list_link T::*Link>
+class intrusive_slist {
+ public:
+  template <bool Const>
+  class iter {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef typename std::conditional<Const, const T*, T*>::type pointer;
+    typedef typename std::conditional<Const, const T&, T&>::type reference;
+
+    iter() : l_(nullptr) {}
+    explicit iter(fcl_list_link *l) : l_(l) {}
+    template <bool C, typename = typename std::enable_if<Const && !C>::type>
+    iter(const iter<C> &o) : l_(o.link()) {}
+
+    reference operator*() const { return *detail::container_of(l_, Link); }
+    pointer operator->() const { return detail::container_of(l_, Link); }
+    iter &operator++() { l_ = l_->next; return *this; }
+    iter operator++(int) { iter t = *this; l_ = l_->next; return t; }
+    bool operator==(const iter &o) const { return l_ == o.l_; }
+    bool operator!=(const iter &o) const { return l_ != o.l_; }
+    fcl_list_link *link() const { return l_; }
+
+   private:
+    fcl_list_link *l_;
+  };
+
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef iter<false> iterator;
+  typedef iter<true> const_iterator;
+
+  intrusive_slist() : first_(nullptr), last_(nullptr) {}
+  intrusive_slist(const intrusive_slist&) = delete;
+  intrusive_slist &operator=(const intrusive_slist&) = delete;
+  intrusive_slist(intrusive_slist &&o) : first_(o.first_), last_(o.last_) {
+    o.first_ = nullptr;
+  }
+  intrusive_slist &operator=(intrusive_slist &&o) {
+    first_ = o.first_;
+    last_ = o.last_;
+    o.first_ = nullptr;
+    return *this;
+  }
+
+  iterator begin() { return iterator(first_); }
+  iterator end() { return iterator(); }
+  const_iterator begin() const { return const_iterator(first_); }
+  const_iterator end() const { return const_iterator(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  bool empty() const { return first_ == nullptr; }
+  size_type size() const {
+    size_type n = 0;
+    for (const fcl_list_link *i = first_; i; i = i->next)
+      n++;
+    return n;
+  }
+  T &front() { assert(!empty()); return *begin(); }
+  T &back() { assert(!empty()); return *iterator(last_); }
+
+  void push_front(T &e) {
+    fcl_list_link *n = &(e.*Link);
+    if (empty())
+      last_ = n;
+    n->next = first_;
+    first_ = n;
+  }
+  void push_back(T &e) {
+    fcl_list_link *n = &(e.*Link);
+    if (empty())
+      first_ = n;
+    else
+      last_->next = n;
+    n->next = nullptr;
+    last_ = n;
+  }
+  void pop_front() {
+    assert(!empty());
+    first_ = first_->next;
+  }
+
+  // inserts e after pos, returns an iterator to e
+  iterator insert_after(iterator pos, T &e) {
+    fcl_list_link *n = &(e.*Link), *prev = pos.link();
+    n->next = prev->next;
+    prev->next = n;
+    if (prev == last_)
+      last_ = n;
+    return iterator(n);
+  }
+  // unlinks the element after pos, returns an iterator to the next one
+  iterator erase_after(iterator pos) {
+    fcl_list_link *prev = pos.link(), *n = prev->next;
+    assert(n);
+    prev->next = n->next;
+    if (n == last_)
+      last_ = prev;
+    return iterator(prev->next);
+  }
+
+  // appends every element of src in O(1), like name##_list_concat
+  void splice_back(intrusive_slist &src) {
+    if (src.empty())
+      return;
+    if (empty())
+      first_ = src.first_;
+    else
+      last_->next = src.first_;
+    last_ = src.last_;
+    src.first_ = nullptr;
+  }
+
+  void clear() { first_ = nullptr; }
+
+ private:
+  // same layout as the head of FCL_LIST_FIFO_DECLARE
+  fcl_list_link *first_;
+  fcl_list_link *last_;
+};
+
+
+// compile-time pool configuration
+// Fifo = recycle in FIFO order instead of LIFO
+// Oom = FCL_ALLOCATOR_OOM_POLICY_ERROR, _DOUBLE or _INCREMENTAL
+// Backend, SlabFlags = as for name##_allocator_init_backend
+// Remote = give the pool a remote free list, see FCL_ALLOCATOR_LL_REMOTE_XXX
+template <bool Fifo, fcl_allocator_oom_policy Oom,
+          fcl_allocator_backend Backend = FCL_ALLOCATOR_BACKEND_ALIGNED_ALLOC,
+          unsigned SlabFlags = 0, bool Remote = false>
+struct pool_policy {
+  static constexpr bool fifo = Fifo;
+  static constexpr fcl_allocator_oom_policy oom = Oom;
+  static constexpr fcl_allocator_backend backend = Backend;
+  static constexpr unsigned slab_flags = SlabFlags;
+  static constexpr bool remote = Remote;
+};
+
+typedef pool_policy<false, FCL_ALLOCATOR_OOM_POLICY_DOUBLE> lifo_grow;
+typedef pool_policy<true, FCL_ALLOCATOR_OOM_POLICY_DOUBLE> fifo_grow;
+typedef pool_policy<false, FCL_ALLOCATOR_OOM_POLICY_ERROR> lifo_fixed;
+typedef pool_policy<true, FCL_ALLOCATOR_OOM_POLICY_ERROR> fifo_fixed;
+
+
+namespace detail {
+
+// a free slot of a pool is linked through its own storage
+template <typename T>
+union pool_slot {
+  fcl_list_link link;
+  alignas(T) unsigned char storage[sizeof(T)];
+};
+
+// a slot of a pool with an element init callback, whose link must not
+// overwrite the object it initialized
+template <typename T>
+struct pool_init_slot {
+  alignas(T) unsigned char storage[sizeof(T)];
+  fcl_list_link link;
+};
+
+// the FCL_ALLOCATOR_LL functions for slots S, as the static members of one
+// specialization per recycle policy, oom policy and remote free list
+template <typename S, bool Fifo, fcl_allocator_oom_policy Oom, bool Remote>
+struct pool_impl;
+
+#define _FCL_POOL_IMPL(fifo, recycle_policy, oom_mode, remote, remote_mode) \
+template <typename S> \
+struct pool_impl<S, fifo, FCL_ALLOCATOR_OOM_POLICY_##oom_mode, remote> { \
+  _FCL_ALLOCATOR_LL_DEFINE_MEMBERS(c, S, fcl_list_link, link, \
+                                   recycle_policy, oom_mode, remote_mode) \
+};
+_FCL_POOL_IMPL(false, LIFO, ERROR, false, LOCAL)
+_FCL_POOL_IMPL(false, LIFO, DOUBLE, false, LOCAL)
+_FCL_POOL_IMPL(false, LIFO, INCREMENTAL, false, LOCAL)
+_FCL_POOL_IMPL(true, FIFO, ERROR, false, LOCAL)
+_FCL_POOL_IMPL(true, FIFO, DOUBLE, false, LOCAL)
+_FCL_POOL_IMPL(true, FIFO, INCREMENTAL, false, LOCAL)
+_FCL_POOL_IMPL(false, LIFO, ERROR, true, REMOTE)
+_FCL_POOL_IMPL(false, LIFO, DOUBLE, true, REMOTE)
+_FCL_POOL_IMPL(false, LIFO, INCREMENTAL, true, REMOTE)
+_FCL_POOL_IMPL(true, FIFO, ERROR, true, REMOTE)
+_FCL_POOL_IMPL(true, FIFO, DOUBLE, true, REMOTE)
+_FCL_POOL_IMPL(true, FIFO, INCREMENTAL, true, REMOTE)
+#undef _FCL_POOL_IMPL
+
+// the element init callback handed to the C allocator, which runs Init on
+// the T in a slot, or none when Init is void
+template <typename S, typename T, typename Init>
+struct pool_elem_init {
+  static void run(S *s) { Init()(reinterpret_cast<T*>(s->storage)); }
+  template <typename Fn>
+  static Fn get() { return run; }
+};
+
+template <typename S, typename T>
+struct pool_elem_init<S, T, void> {
+  template <typename Fn>
+  static Fn get() { return nullptr; }
+};
+
+}  // namespace detail
+
+
+// an FCL_ALLOCATOR_LL pool of T, a wrapper around the functions the C
+// macros generate for the pool's slots
+// Init = void, or a default constructible type whose operator()(T *) is the
+// allocator's element init callback
+template <typename T, typename Policy = lifo_grow, typename Init = void>
+class pool {
+  typedef typename std::conditional<std::is_void<Init>::value,
+                                    detail::pool_slot<T>,
+                                    detail::pool_init_slot<T> >::type slot;
+  typedef detail::pool_impl<slot, Policy::fifo, Policy::oom,
+                            Policy::remote> impl;
+  typedef typename impl::c_allocator_elem_init_fn elem_init_fn;
+  static_assert(alignof(slot) <= LEVEL1_DCACHE_LINESIZE,
+                "slabs are only aligned to LEVEL1_DCACHE_LINESIZE");
+
+ public:
+  // gives an object back to its pool, for std::unique_ptr
+  class deleter {
+   public:
+    deleter() : p_(nullptr) {}
+    explicit deleter(pool *p) : p_(p) {}
+    void operator()(T *e) const { p_->destroy(e); }
+   private:
+    pool *p_;
+  };
+  typedef std::unique_ptr<T, deleter> handle;
+
+  // initial_size = number of objects in the first slab
+  // inc = growth increment for FCL_ALLOCATOR_OOM_POLICY_INCREMENTAL
+  // throws std::bad_alloc if the first slab cannot be allocated
+  explicit pool(std::size_t initial_size, std::size_t inc = 0) {
+    if (impl::c_allocator_init_backend(
+            &a_, initial_size, Policy::oom, inc,
+            detail::pool_elem_init<slot, T, Init>::template get<
+                elem_init_fn>(),
+            Policy::backend, Policy::slab_flags) != 1)
+      throw std::bad_alloc();
+  }
+  pool(const pool&) = delete;
+  pool &operator=(const pool&) = delete;
+  ~pool() { impl::c_allocator_freeall(&a_); }
+
+  // returns storage for a T, or nullptr, like name##_allocator_borrow
+  T *borrow() {
+    slot *s = impl::c_allocator_borrow(&a_);
+    return s ? reinterpret_cast<T*>(s->storage) : nullptr;
+  }
+
+  // gives back storage from borrow, whose T has already been destructed
+  void give_back(T *e) {
+    assert(e);
+    impl::c_allocator_return(&a_, reinterpret_cast<slot*>(e));
+  }
+
+  // give_back from a thread that does not own the pool, and the owner's
+  // explicit reclaim, with a Remote policy, see
+  // name##_allocator_return_remote
+  void give_back_remote(T *e) {
+    static_assert(Policy::remote, "the pool has no remote free list");
+    assert(e);
+    impl::c_allocator_return_remote(&a_, reinterpret_cast<slot*>(e));
+  }
+  std::size_t reclaim() {
+    static_assert(Policy::remote, "the pool has no remote free list");
+    return impl::c_allocator_reclaim(&a_);
+  }
+
+  // borrows and constructs a T, or returns nullptr
+  template <typename... Args>
+  T *make(Args&&... args) {
+    T *e = borrow();
+    if (!e)
+      return nullptr;
+    try {
+      return new (e) T(std::forward<Args>(args)...);
+    } catch (...) {
+      give_back(e);
+      throw;
+    }
+  }
+  template <typename... Args>
+  handle make_unique(Args&&... args) {
+    return handle(make(std::forward<Args>(args)...), deleter(this));
+  }
+
+  // destructs and gives back a T from make
+  void destroy(T *e) {
+    assert(e);
+    e->~T();
+    give_back(e);
+  }
+
+  // selects when Init runs, see name##_allocator_set_init_policy.  The
+  // PROTOTYPE policy takes a prototype through set_prototype instead.
+  void set_init_policy(fcl_allocator_init_policy init_policy) {
+    assert(init_policy != FCL_ALLOCATOR_INIT_POLICY_PROTOTYPE);
+    impl::c_allocator_set_init_policy(&a_, init_policy, nullptr);
+  }
+  // every borrow copies proto, which the pool keeps a copy of
+  void set_prototype(const T &proto) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "prototypes are copied with memcpy");
+    std::memcpy(proto_.storage, &proto, sizeof(T));
+    impl::c_allocator_set_init_policy(&a_, FCL_ALLOCATOR_INIT_POLICY_PROTOTYPE,
+                                      &proto_);
+  }
+  // initializes up to n objects given back under the DEFERRED policy
+  std::size_t reinit(std::size_t n) {
+    return impl::c_allocator_reinit(&a_, n);
+  }
+
+  // releases slabs whose objects are all free, see name##_allocator_trim
+  std::size_t trim(std::size_t keep) {
+    return impl::c_allocator_trim(&a_, keep);
+  }
+  // counters are only maintained when compiled with -DFCL_ALLOCATOR_STATS
+  fcl_allocator_stats stats() {
+    fcl_allocator_stats s;
+    impl::c_allocator_stats(&a_, &s);
+    return s;
+  }
+
+  std::size_t free_count() const { return a_.free_count; }
+  std::size_t total_count() const { return a_.total_count; }
+  std::size_t in_use() const { return a_.total_count - a_.free_count; }
+  fcl_allocator_backend backend() const { return a_.backend; }
+
+ private:
+  typename impl::c_allocator a_;
+  slot proto_;
+};
+
+}  // namespace fcl
+
+#endif  // _FCL_HPP_
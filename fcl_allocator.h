@@ -22,7 +22,90 @@
 
    Via the optional element initialization callback, FCL_ALLOCATOR_LL maintains
    an invariant where all elements on the free list are always in the
-   initialized state.
+   initialized state.  Running the callback on every return pulls the whole
+   object into the cache, even when the next user overwrites it, so
+   name##_allocator_set_init_policy selects when (and whether) it runs:
+     ON_RETURN (the default): return runs elem_init.  Every free object is
+       initialized, and so is every borrowed one.
+     ON_BORROW: borrow runs elem_init instead.  Free objects hold whatever
+       their last user left; every borrowed object is initialized.
+     NONE: elem_init never runs.  A borrowed object holds whatever its last
+       user left, or uninitialized memory the first time it is borrowed.
+     PROTOTYPE: borrow copies a caller supplied prototype object over the
+       whole object with memcpy, and elem_init never runs.  Free objects hold
+       whatever their last user left; every borrowed object equals the
+       prototype.  The prototype must outlive the policy.
+     DEFERRED: return puts the object on a dirty list without touching it
+       beyond the link.  name##_allocator_reinit initializes up to n dirty
+       objects and moves them to the free list, eg when the caller is idle.
+       Bulk returns initialize their whole batch in one pass, and a borrow
+       that finds the free list empty initializes a dirty object before
+       carving a new one.  Every object on the free list is initialized,
+       objects on the dirty list are not, and every borrowed object is.
+   The policy may be changed at any time: dirty objects are initialized
+   first, and the free list is initialized when the new policy requires it.
+
+   New memory (the initial allocation and every growth) is not threaded onto
+   the free list up front.  Each allocator keeps a bump pointer into the
+   unused tail of its newest allocation, and borrow carves (and initializes)
+   a fresh element from it only when the free list is empty.  Init and growth
+   are therefore O(1), and pages are first touched when an element on them is
+   first borrowed.  free_count counts both the free list and the uncarved
+   elements.
+
+   Memory is allocated in slabs from a selectable backend: aligned_alloc
+   (the default), anonymous mmap, mmap with transparent hugepages
+   (madvise MADV_HUGEPAGE), or mmap from the hugetlb pool (MAP_HUGETLB).
+   Slabs may be prefaulted (MAP_POPULATE or touching every page) and locked
+   in memory (mlock).  A backend or flag that is unavailable falls back
+   instead of failing; after init, a->backend and a->slab_flags report what
+   was actually obtained, and later growth uses the same.  A slab is rounded
+   up to the backend's page size, and every element that fits in it is
+   used, so total_count may exceed the size asked for.
+
+   Slabs are kept sorted by address, so the slab owning an element is found
+   with a binary search.  name##_allocator_trim releases slabs whose elements
+   are all free back to the system, keeping at least keep free elements.
+   Occupancy is computed by trim itself from the free list, so borrow and
+   return pay nothing for it; trim is O(free elements * log(slabs)) and
+   should be called off the hot path, eg after a traffic burst.
+
+   When compiled with -DFCL_ALLOCATOR_STATS, each allocator counts borrows,
+   returns, growth events and failures, the high-water mark of objects in
+   use, and the time spent allocating slabs with a log2 latency histogram.
+   name##_allocator_stats copies a snapshot.  Without the define all code
+   updating the counters compiles away; the counters themselves stay in the
+   allocator struct, so its layout does not depend on the define and units
+   built with and without it may share allocators.  Growth can also be
+   traced by defining FCL_ALLOCATOR_TRACE_GROW before including this file.
+
+   Objects may also be borrowed and returned in batches.  A bulk borrow grows
+   the pool at most once, by enough to satisfy the whole batch, and may
+   return fewer objects than requested if growth is not possible.  A whole
+   list of objects linked via the free list functions (name##_free_list_XXX)
+   may be returned at once; it is spliced onto the free list in O(1), plus
+   one pass over the list when objects are initialized as they are returned.
+
+   Allocators generated by FCL_ALLOCATOR_LL_REMOTE_XXX also carry a
+   lock-free remote free list.  The allocator still belongs to one owning
+   thread, but any other thread may give an object back with
+   name##_allocator_return_remote, which pushes it onto the remote list with
+   a compare-and-swap and touches nothing else.  When the owner's free list
+   runs dry, borrow (and borrow_bulk and trim) first takes the whole remote
+   list with one atomic exchange and returns each object as the owner, and
+   only grows the pool if it was empty.  The owner may also reclaim
+   explicitly with name##_allocator_reclaim.  The element init and the
+   counters are thus only ever run on the owning thread.  The remote list is
+   only drained on these paths, so borrow and return by the owner pay
+   nothing while the free list is not empty.  Objects on the remote list
+   count as in use until they are reclaimed.
+
+   FCL_ALLOCATOR_LL_POLICY_XXX fix the oom policy when the functions are
+   generated, so the policy switch in the growth path folds away.
+   FCL_ALLOCATOR_LL_DEFINE_STATIC generates static inline functions, and
+   replaces both the DECLARE and DEFINE macros (see fcl_list.h).  Borrow and
+   return are then inlined into the caller, leaving a free list pop or push,
+   a counter update, and the element init check; growth stays out of line.
 */
 
 #ifndef _FCL_ALLOCATOR_H_
@@ -31,19 +114,39 @@
 #include <stdint.h>     // uint32_t
 #include <assert.h>     // assert
 #include <stdlib.h>     // aligned_alloc
+#include <string.h>     // memset
 #include "fcl_list.h"
+#include <time.h>       // clock_gettime, timespec_get
+#ifdef __linux__
+#include <sys/mman.h>   // mmap, madvise, mlock
+#include <unistd.h>     // sysconf
+#endif
+#ifdef __cplusplus
+#include <atomic>       // std::atomic
+#else
+#include <stdatomic.h>  // atomic_exchange_explicit
+#endif
 
-#ifndef LEVEL1_DCACHE_LINESIZE
-/*! Used to align and place objects to avoid false sharing
+#define FCL_ALLOCATOR_LL_DEFAULT_ALLOCATIONS 8
 
-  On modern Intel x86 CPUs, this is typically 64 bytes
-  On Linux it can be defined while compiling with
-  \verbatim -DLEVEL1_DCACHE_LINESIZE=`getconf LEVEL1_DCACHE_LINESIZE` \endverbatim
-*/
-#define LEVEL1_DCACHE_LINESIZE 64
+#ifndef FCL_ALLOCATOR_HUGEPAGE_SIZE
+#define FCL_ALLOCATOR_HUGEPAGE_SIZE (2 * 1024 * 1024)
 #endif
 
-#define FCL_ALLOCATOR_LL_DEFAULT_ALLOCATIONS 8
+// slab flags: touch every page up front, and lock the pages in memory
+#define FCL_ALLOCATOR_SLAB_PREFAULT 0x1
+#define FCL_ALLOCATOR_SLAB_MLOCK 0x2
+
+// the oom policy of an allocator, read at runtime or fixed by oom_mode
+#define _FCL_ALLOCATOR_OOM_RUNTIME(a) ((a)->oom_policy)
+#define _FCL_ALLOCATOR_OOM_ERROR(a) FCL_ALLOCATOR_OOM_POLICY_ERROR
+#define _FCL_ALLOCATOR_OOM_DOUBLE(a) FCL_ALLOCATOR_OOM_POLICY_DOUBLE
+#define _FCL_ALLOCATOR_OOM_INCREMENTAL(a) FCL_ALLOCATOR_OOM_POLICY_INCREMENTAL
+
+// the free list function that recycles a whole list in policy order
+#define _FCL_ALLOCATOR_LL_RECYCLE_ALL_FIFO(name) name##_free_list_concat
+#define _FCL_ALLOCATOR_LL_RECYCLE_ALL_LIFO(name) name##_free_list_splice
+#define _FCL_ALLOCATOR_LL_RECYCLE_ALL_LIFO_ATOMIC(name) name##_free_list_splice
 
 typedef enum fcl_allocator_recycle_policy {
   FCL_ALLOCATOR_RECYCLE_POLICY_NONE,
@@ -51,6 +154,14 @@ typedef enum fcl_allocator_recycle_policy {
   FCL_ALLOCATOR_RECYCLE_POLICY_LIFO
 } fcl_allocator_recycle_policy;
 
+typedef enum fcl_allocator_init_policy {
+  FCL_ALLOCATOR_INIT_POLICY_ON_RETURN,
+  FCL_ALLOCATOR_INIT_POLICY_ON_BORROW,
+  FCL_ALLOCATOR_INIT_POLICY_NONE,
+  FCL_ALLOCATOR_INIT_POLICY_PROTOTYPE,
+  FCL_ALLOCATOR_INIT_POLICY_DEFERRED
+} fcl_allocator_init_policy;
+
 typedef enum fcl_allocator_oom_policy {
   FCL_ALLOCATOR_OOM_POLICY_NONE,
   FCL_ALLOCATOR_OOM_POLICY_ERROR,
@@ -58,6 +169,285 @@ typedef enum fcl_allocator_oom_policy {
   FCL_ALLOCATOR_OOM_POLICY_INCREMENTAL
 } fcl_allocator_oom_policy;
 
+// where slabs come from.  A backend that is unavailable falls back to the
+// next one in the order HUGETLB, THP, MMAP, ALIGNED_ALLOC.
+typedef enum fcl_allocator_backend {
+  FCL_ALLOCATOR_BACKEND_ALIGNED_ALLOC,
+  FCL_ALLOCATOR_BACKEND_MMAP,
+  FCL_ALLOCATOR_BACKEND_MMAP_THP,
+  FCL_ALLOCATOR_BACKEND_MMAP_HUGETLB
+} fcl_allocator_backend;
+
+// number of log2(nanoseconds) buckets in the growth latency histogram
+#define FCL_ALLOCATOR_STATS_HIST_BUCKETS 32
+
+// counters are only maintained when compiled with -DFCL_ALLOCATOR_STATS.
+// in_use, free and total are always reported.
+struct fcl_allocator_stats {
+  uint64_t borrows;         // objects handed out
+  uint64_t failed_borrows;  // borrows that found no object
+  uint64_t returns;         // objects given back
+  uint64_t grows;           // slab allocations, including the initial one
+  uint64_t failed_grows;    // slab allocations that failed
+  uint64_t grow_ns;         // total time spent allocating slabs
+  uint64_t grow_hist[FCL_ALLOCATOR_STATS_HIST_BUCKETS]; // grows by log2(ns)
+  size_t in_use;
+  size_t in_use_hwm;        // high-water mark of in_use
+  size_t free;
+  size_t total;
+};
+
+// growth tracepoint, eg for a USDT probe:
+// #define FCL_ALLOCATOR_TRACE_GROW(a, count, ns, ok) DTRACE_PROBE3(...)
+// ns is only measured when compiled with -DFCL_ALLOCATOR_STATS, else 0.
+#ifndef FCL_ALLOCATOR_TRACE_GROW
+#define FCL_ALLOCATOR_TRACE_GROW(a, count, ns, ok)
+#endif
+
+#ifdef FCL_ALLOCATOR_STATS
+static inline uint64_t fcl_allocator_now_ns(void) {
+  struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  timespec_get(&ts, TIME_UTC);
+#endif
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void fcl_allocator_stats_grow(struct fcl_allocator_stats *s,
+                                            uint64_t ns) {
+  unsigned bucket = 0;
+  s->grows++;
+  s->grow_ns += ns;
+  while ((ns >>= 1) && bucket < FCL_ALLOCATOR_STATS_HIST_BUCKETS - 1)
+    bucket++;
+  s->grow_hist[bucket]++;
+}
+
+#define _FCL_ALLOCATOR_STATS_ADD(a, counter, n) ((a)->stats.counter += (n))
+#define _FCL_ALLOCATOR_STATS_HWM(a) \
+  do { \
+    if ((a)->total_count - (a)->free_count > (a)->stats.in_use_hwm) \
+      (a)->stats.in_use_hwm = (a)->total_count - (a)->free_count; \
+  } while (0)
+#define _FCL_ALLOCATOR_STATS_NOW() fcl_allocator_now_ns()
+#define _FCL_ALLOCATOR_STATS_GROW(a, ns) fcl_allocator_stats_grow(&(a)->stats, ns)
+#else
+#define _FCL_ALLOCATOR_STATS_ADD(a, counter, n)
+#define _FCL_ALLOCATOR_STATS_HWM(a)
+#define _FCL_ALLOCATOR_STATS_NOW() 0
+#define _FCL_ALLOCATOR_STATS_GROW(a, ns)
+#endif
+
+#ifdef __cplusplus
+// the part of the C++23 <stdatomic.h> the remote free list uses; the
+// atomic_xxx functions are found in std by argument dependent lookup
+#define _FCL_ALLOCATOR_ATOMIC(t) std::atomic<t>
+#define _FCL_ALLOCATOR_MO_RELAXED std::memory_order_relaxed
+#define _FCL_ALLOCATOR_MO_ACQUIRE std::memory_order_acquire
+#define _FCL_ALLOCATOR_MO_RELEASE std::memory_order_release
+#else
+#define _FCL_ALLOCATOR_ATOMIC(t) _Atomic(t)
+#define _FCL_ALLOCATOR_MO_RELAXED memory_order_relaxed
+#define _FCL_ALLOCATOR_MO_ACQUIRE memory_order_acquire
+#define _FCL_ALLOCATOR_MO_RELEASE memory_order_release
+#endif
+
+// the remote free list of an allocator, selected by remote_mode: LOCAL
+// allocators have none, REMOTE allocators keep it a cache line away from
+// the owner's fields
+#define _FCL_ALLOCATOR_LOCAL_FIELD(field_type)
+#define _FCL_ALLOCATOR_LOCAL_INIT(a, field_type)
+#define _FCL_ALLOCATOR_LOCAL_RECLAIM(name, a) 0
+#define _FCL_ALLOCATOR_LOCAL_DECLARE(scope, name, type)
+#define _FCL_ALLOCATOR_LOCAL_DEFINE(scope, name, type, field_type, field)
+#define _FCL_ALLOCATOR_REMOTE_FIELD(field_type) \
+  char remote_pad[LEVEL1_DCACHE_LINESIZE];  \
+  _FCL_ALLOCATOR_ATOMIC(field_type *) remote_free;
+#define _FCL_ALLOCATOR_REMOTE_INIT(a, field_type) \
+  atomic_init(&(a)->remote_free, (field_type *)NULL)
+#define _FCL_ALLOCATOR_REMOTE_RECLAIM(name, a) name##_allocator_reclaim(a)
+#define _FCL_ALLOCATOR_REMOTE_DECLARE(scope, name, type) \
+scope void name##_allocator_return_remote(struct name##_allocator *a, \
+                                          type *e); \
+scope size_t name##_allocator_reclaim(struct name##_allocator *a);
+#define _FCL_ALLOCATOR_REMOTE_DEFINE(scope, name, type, field_type, field) \
+scope void name##_allocator_return_remote(struct name##_allocator *a, \
+                                          type *e) { \
+  assert(a);  \
+  assert(e);  \
+  field_type *first;  \
+  first = atomic_load_explicit(&a->remote_free, _FCL_ALLOCATOR_MO_RELAXED); \
+  do {  \
+    e->field.next = first;  \
+  } while (!atomic_compare_exchange_weak_explicit(&a->remote_free, &first, \
+                                                  &e->field, \
+                                                  _FCL_ALLOCATOR_MO_RELEASE, \
+                                                  _FCL_ALLOCATOR_MO_RELAXED)); \
+} \
+scope size_t name##_allocator_reclaim(struct name##_allocator *a) { \
+  assert(a);  \
+  field_type *l, *next; \
+  size_t n = 0; \
+  if (!atomic_load_explicit(&a->remote_free, _FCL_ALLOCATOR_MO_RELAXED)) \
+    return 0; \
+  l = atomic_exchange_explicit(&a->remote_free, (field_type *)NULL, \
+                               _FCL_ALLOCATOR_MO_ACQUIRE); \
+  for (; l; l = next, n++) {  \
+    next = l->next; \
+    name##_allocator_return(a, name##_free_list_get_entry(l)); \
+  } \
+  return n; \
+}
+
+struct fcl_allocator_slab {
+  void *mem;
+  size_t count;
+  size_t bytes;
+  fcl_allocator_backend backend;
+  unsigned flags;
+};
+
+static inline size_t fcl_allocator_round_up(size_t n, size_t align) {
+  return (n + align - 1) / align * align;
+}
+
+// the system page size, or 4096 where it cannot be queried
+static inline size_t fcl_allocator_page_size(void) {
+#if defined(__linux__) && defined(_SC_PAGESIZE)
+  long n = sysconf(_SC_PAGESIZE);
+  if (n > 0)
+    return (size_t)n;
+#endif
+  return 4096;
+}
+
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+// maps @bytes bytes aligned to @align, by mapping @align - page size bytes
+// more and unmapping the misaligned head and the tail
+static inline void *fcl_allocator_mmap_aligned(size_t bytes, size_t align,
+                                               int mmap_flags) {
+  size_t page = fcl_allocator_page_size();
+  size_t len = bytes + align - page;
+  char *p, *aligned;
+
+  p = (char *)mmap(NULL, len, PROT_READ | PROT_WRITE, mmap_flags, -1, 0);
+  if (p == MAP_FAILED)
+    return NULL;
+  aligned = (char *)fcl_allocator_round_up((uintptr_t)p, align);
+  if (aligned != p)
+    munmap(p, aligned - p);
+  if (aligned + bytes != p + len)
+    munmap(aligned + bytes, p + len - (aligned + bytes));
+  return aligned;
+}
+#endif
+
+// allocates a slab of at least @bytes bytes aligned to
+// LEVEL1_DCACHE_LINESIZE from @backend or the first available fallback.
+// slab->bytes is the size actually allocated, rounded up to the page size
+// of the backend.  slab->backend and slab->flags report what was actually
+// obtained.  Transparent hugepage slabs are aligned to
+// FCL_ALLOCATOR_HUGEPAGE_SIZE, so the kernel may back them with hugepages,
+// and are prefaulted by touching them after the madvise, since
+// MAP_POPULATE would fault them in as small pages.
+static inline int fcl_allocator_slab_alloc(struct fcl_allocator_slab *slab,
+                                           size_t bytes,
+                                           fcl_allocator_backend backend,
+                                           unsigned flags) {
+  assert(slab);
+  int populated = 0;
+  (void)backend;
+  slab->mem = NULL;
+  slab->flags = flags;
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+  int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS, populate = 0;
+#ifdef MAP_POPULATE
+  if (flags & FCL_ALLOCATOR_SLAB_PREFAULT)
+    populate = MAP_POPULATE;
+#endif
+#ifdef MAP_HUGETLB
+  if (backend == FCL_ALLOCATOR_BACKEND_MMAP_HUGETLB) {
+    slab->bytes = fcl_allocator_round_up(bytes, FCL_ALLOCATOR_HUGEPAGE_SIZE);
+    slab->mem = mmap(NULL, slab->bytes, PROT_READ | PROT_WRITE,
+                     mmap_flags | populate | MAP_HUGETLB, -1, 0);
+    if (slab->mem == MAP_FAILED)
+      slab->mem = NULL;
+    populated = populate != 0;
+  }
+#endif
+  if (!slab->mem && backend >= FCL_ALLOCATOR_BACKEND_MMAP_THP) {
+    backend = FCL_ALLOCATOR_BACKEND_MMAP_THP;
+    slab->bytes = fcl_allocator_round_up(bytes, FCL_ALLOCATOR_HUGEPAGE_SIZE);
+    slab->mem = fcl_allocator_mmap_aligned(slab->bytes,
+                                           FCL_ALLOCATOR_HUGEPAGE_SIZE,
+                                           mmap_flags);
+    populated = 0;
+#ifdef MADV_HUGEPAGE
+    if (slab->mem && madvise(slab->mem, slab->bytes, MADV_HUGEPAGE) != 0)
+      backend = FCL_ALLOCATOR_BACKEND_MMAP;
+#else
+    backend = FCL_ALLOCATOR_BACKEND_MMAP;
+#endif
+  }
+  if (!slab->mem && backend >= FCL_ALLOCATOR_BACKEND_MMAP) {
+    backend = FCL_ALLOCATOR_BACKEND_MMAP;
+    slab->bytes = fcl_allocator_round_up(bytes, fcl_allocator_page_size());
+    slab->mem = mmap(NULL, slab->bytes, PROT_READ | PROT_WRITE,
+                     mmap_flags | populate, -1, 0);
+    if (slab->mem == MAP_FAILED)
+      slab->mem = NULL;
+    populated = populate != 0;
+  }
+  if (slab->mem) {
+    slab->backend = backend;
+    if ((flags & FCL_ALLOCATOR_SLAB_MLOCK) &&
+        mlock(slab->mem, slab->bytes) != 0)
+      slab->flags &= ~FCL_ALLOCATOR_SLAB_MLOCK;
+  }
+#endif
+  if (!slab->mem) {
+    populated = 0;
+    slab->backend = FCL_ALLOCATOR_BACKEND_ALIGNED_ALLOC;
+    slab->bytes = fcl_allocator_round_up(bytes, LEVEL1_DCACHE_LINESIZE);
+    slab->mem = aligned_alloc(LEVEL1_DCACHE_LINESIZE, slab->bytes);
+    if (!slab->mem)
+      return -1;
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+    if ((flags & FCL_ALLOCATOR_SLAB_MLOCK) &&
+        mlock(slab->mem, slab->bytes) != 0)
+      slab->flags &= ~FCL_ALLOCATOR_SLAB_MLOCK;
+#else
+    slab->flags &= ~FCL_ALLOCATOR_SLAB_MLOCK;
+#endif
+  }
+  if ((flags & FCL_ALLOCATOR_SLAB_PREFAULT) && !populated) {
+    size_t i, page = fcl_allocator_page_size();
+    for (i=0; i < slab->bytes; i += page)
+      memset((char*)slab->mem + i, 0, 1);
+  }
+  return 1;
+}
+
+static inline void fcl_allocator_slab_free(struct fcl_allocator_slab *slab) {
+  assert(slab);
+  if (!slab->mem)
+    return;
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+  if (slab->backend != FCL_ALLOCATOR_BACKEND_ALIGNED_ALLOC) {
+    munmap(slab->mem, slab->bytes);
+  } else {
+    if (slab->flags & FCL_ALLOCATOR_SLAB_MLOCK)
+      munlock(slab->mem, slab->bytes);
+    free(slab->mem);
+  }
+#else
+  free(slab->mem);
+#endif
+  slab->mem = NULL;
+}
+
 
 // name = allocator prefix, eg node
 // type = container type, eg struct my_node
@@ -68,49 +458,183 @@ typedef enum fcl_allocator_oom_policy {
 // FCL_ALLOCATOR_LL_DEFINE(node, struct my_node, struct fcl_list_links, links,
 //                         FIFO)
 #define FCL_ALLOCATOR_LL_DECLARE(name, type, field_type, field, recycle_policy) \
-FCL_LIST_##recycle_policy##_DECLARE(name##_free, type, field_type, field) \
+  _FCL_ALLOCATOR_LL_DECLARE(, name, type, field_type, field, recycle_policy, \
+                            LOCAL)
+
+#define FCL_ALLOCATOR_LL_DEFINE(name, type, field_type, field, recycle_policy) \
+  _FCL_ALLOCATOR_LL_DEFINE(, name, type, field_type, field, recycle_policy, \
+                           RUNTIME, LOCAL)
+
+// same as FCL_ALLOCATOR_LL_XXX, with the oom policy fixed at generation time
+// oom_mode = ERROR, DOUBLE or INCREMENTAL, which must also be passed to init
+#define FCL_ALLOCATOR_LL_POLICY_DECLARE(name, type, field_type, field, \
+                                        recycle_policy, oom_mode) \
+  _FCL_ALLOCATOR_LL_DECLARE(, name, type, field_type, field, recycle_policy, \
+                            LOCAL)
+
+#define FCL_ALLOCATOR_LL_POLICY_DEFINE(name, type, field_type, field, \
+                                       recycle_policy, oom_mode) \
+  _FCL_ALLOCATOR_LL_DEFINE(, name, type, field_type, field, recycle_policy, \
+                           oom_mode, LOCAL)
+
+// same as FCL_ALLOCATOR_LL_POLICY_XXX, with static inline functions
+// oom_mode may also be RUNTIME to keep the policy passed to init
+#define FCL_ALLOCATOR_LL_DEFINE_STATIC(name, type, field_type, field, \
+                                       recycle_policy, oom_mode) \
+  _FCL_ALLOCATOR_LL_DECLARE(static inline, name, type, field_type, field, \
+                            recycle_policy, LOCAL) \
+  _FCL_ALLOCATOR_LL_DEFINE(static inline, name, type, field_type, field, \
+                           recycle_policy, oom_mode, LOCAL)
+
+// same as FCL_ALLOCATOR_LL_XXX, with a remote free list
+#define FCL_ALLOCATOR_LL_REMOTE_DECLARE(name, type, field_type, field, \
+                                        recycle_policy) \
+  _FCL_ALLOCATOR_LL_DECLARE(, name, type, field_type, field, recycle_policy, \
+                            REMOTE)
+
+#define FCL_ALLOCATOR_LL_REMOTE_DEFINE(name, type, field_type, field, \
+                                       recycle_policy) \
+  _FCL_ALLOCATOR_LL_DEFINE(, name, type, field_type, field, recycle_policy, \
+                           RUNTIME, REMOTE)
+
+// same as FCL_ALLOCATOR_LL_DEFINE_STATIC, with a remote free list
+#define FCL_ALLOCATOR_LL_REMOTE_DEFINE_STATIC(name, type, field_type, field, \
+                                              recycle_policy, oom_mode) \
+  _FCL_ALLOCATOR_LL_DECLARE(static inline, name, type, field_type, field, \
+                            recycle_policy, REMOTE) \
+  _FCL_ALLOCATOR_LL_DEFINE(static inline, name, type, field_type, field, \
+                           recycle_policy, oom_mode, REMOTE)
+
+// same as FCL_ALLOCATOR_LL_DEFINE_STATIC, for expansion inside a C++ class:
+// the structs are nested in the class and every function is a static member
+// function, see fcl.hpp
+#define _FCL_ALLOCATOR_LL_DEFINE_MEMBERS(name, type, field_type, field, \
+                                         recycle_policy, oom_mode, \
+                                         remote_mode) \
+  _FCL_LIST_##recycle_policy##_HEAD(name##_free, field_type, NOLEN) \
+  _FCL_ALLOCATOR_LL_TYPES(name, type, field_type, remote_mode) \
+  _FCL_ALLOCATOR_LL_DEFINE(static, name, type, field_type, field, \
+                           recycle_policy, oom_mode, remote_mode)
+
+// remote_mode = LOCAL or REMOTE, whether the allocator has a remote free list
+#define _FCL_ALLOCATOR_LL_DECLARE(scope, name, type, field_type, field, \
+                                  recycle_policy, remote_mode) \
+_FCL_LIST_##recycle_policy##_DECLARE(scope, name##_free, type, field_type, \
+                                     field, NOLEN) \
+_FCL_ALLOCATOR_LL_TYPES(name, type, field_type, remote_mode) \
+_FCL_ALLOCATOR_LL_PROTOTYPES(scope, name, type, field_type, remote_mode)
+
+#define _FCL_ALLOCATOR_LL_TYPES(name, type, field_type, remote_mode) \
 typedef void (*name##_allocator_elem_init_fn)(type *);  \
 struct name##_allocator { \
   struct name##_free_list_head free_list; \
   size_t free_count; \
   size_t total_count; \
   size_t increment; \
-  type** allocations; \
+  type *carve_next; \
+  type *carve_end;  \
+  struct fcl_allocator_slab *allocations; \
   name##_allocator_elem_init_fn elem_init; \
+  name##_allocator_elem_init_fn free_init; \
+  name##_allocator_elem_init_fn borrow_init; \
+  const type *prototype;  \
+  struct name##_free_list_head dirty_list;  \
+  size_t dirty_count; \
+  fcl_allocator_init_policy init_policy;  \
   uint32_t num_allocations; \
+  uint32_t num_slabs; \
   fcl_allocator_oom_policy oom_policy;  \
-};  \
-int name##_allocator_init(struct name##_allocator *a, size_t initial_size, \
-                          fcl_allocator_oom_policy oom_policy, size_t inc, \
-                          name##_allocator_elem_init_fn elem_init); \
-void name##_allocator_freeall(struct name##_allocator *a);  \
-int _##name##_allocator_allocate(struct name##_allocator *a); \
-type *name##_allocator_borrow(struct name##_allocator *a);  \
-void name##_allocator_return(struct name##_allocator *a, type *e);
+  fcl_allocator_backend backend;  \
+  unsigned slab_flags;  \
+  struct fcl_allocator_stats stats; \
+  _FCL_ALLOCATOR_##remote_mode##_FIELD(field_type) \
+};
 
-#define FCL_ALLOCATOR_LL_DEFINE(name, type, field_type, field, recycle_policy) \
-FCL_LIST_##recycle_policy##_DEFINE(name##_free, type, field_type, field) \
-int name##_allocator_init(struct name##_allocator *a, size_t initial_size, \
-                          fcl_allocator_oom_policy oom_policy, size_t inc, \
-                          name##_allocator_elem_init_fn elem_init) {  \
+#define _FCL_ALLOCATOR_LL_PROTOTYPES(scope, name, type, field_type, \
+                                     remote_mode) \
+scope int name##_allocator_init( \
+    struct name##_allocator *a, size_t initial_size, \
+    fcl_allocator_oom_policy oom_policy, size_t inc, \
+    name##_allocator_elem_init_fn elem_init); \
+scope int name##_allocator_init_backend( \
+    struct name##_allocator *a, size_t initial_size, \
+    fcl_allocator_oom_policy oom_policy, size_t inc, \
+    name##_allocator_elem_init_fn elem_init, fcl_allocator_backend backend, \
+    unsigned slab_flags); \
+scope void name##_allocator_freeall(struct name##_allocator *a);  \
+scope int _##name##_allocator_allocate( \
+    struct name##_allocator *a, size_t count); \
+scope int _##name##_allocator_grow(struct name##_allocator *a, size_t need); \
+scope type *_##name##_allocator_carve(struct name##_allocator *a);  \
+scope type *_##name##_allocator_take_dirty(struct name##_allocator *a); \
+scope void _##name##_allocator_borrow_init(struct name##_allocator *a, \
+                                           type *e); \
+scope size_t name##_allocator_reinit(struct name##_allocator *a, size_t n); \
+scope int name##_allocator_set_init_policy( \
+    struct name##_allocator *a, fcl_allocator_init_policy init_policy, \
+    const type *prototype); \
+scope long _##name##_allocator_find_slab( \
+    struct name##_allocator *a, const type *e); \
+scope size_t name##_allocator_trim(struct name##_allocator *a, size_t keep); \
+scope void name##_allocator_stats(struct name##_allocator *a, \
+                                  struct fcl_allocator_stats *out); \
+_FCL_ALLOCATOR_##remote_mode##_DECLARE(scope, name, type) \
+scope type *name##_allocator_borrow(struct name##_allocator *a);  \
+scope size_t _##name##_allocator_take_bulk( \
+    struct name##_allocator *a, type **out, size_t n); \
+scope size_t name##_allocator_borrow_bulk( \
+    struct name##_allocator *a, type **out, size_t n); \
+scope void name##_allocator_return(struct name##_allocator *a, type *e); \
+scope void _##name##_allocator_put_bulk(struct name##_allocator *a, \
+                                        type **e, size_t n); \
+scope void name##_allocator_return_bulk(struct name##_allocator *a, type **e, \
+                                        size_t n);  \
+scope void name##_allocator_return_list( \
+    struct name##_allocator *a, struct name##_free_list_head *l, size_t n);
+
+#define _FCL_ALLOCATOR_LL_DEFINE(scope, name, type, field_type, field, \
+                                 recycle_policy, oom_mode, remote_mode) \
+_FCL_LIST_##recycle_policy##_DEFINE(scope, name##_free, type, field_type, \
+                                    field, NOLEN) \
+scope int name##_allocator_init( \
+    struct name##_allocator *a, size_t initial_size, \
+    fcl_allocator_oom_policy oom_policy, size_t inc, \
+    name##_allocator_elem_init_fn elem_init) { \
+  return name##_allocator_init_backend(a, initial_size, oom_policy, inc, \
+                                       elem_init, \
+                                       FCL_ALLOCATOR_BACKEND_ALIGNED_ALLOC, 0);\
+} \
+scope int name##_allocator_init_backend( \
+    struct name##_allocator *a, size_t initial_size, \
+    fcl_allocator_oom_policy oom_policy, size_t inc, \
+    name##_allocator_elem_init_fn elem_init, fcl_allocator_backend backend, \
+    unsigned slab_flags) { \
   assert(a);  \
-  type *new_structs;  \
-  size_t i; \
-  a->allocations = calloc(FCL_ALLOCATOR_LL_DEFAULT_ALLOCATIONS, sizeof(type*));\
+  a->allocations = (struct fcl_allocator_slab *)calloc( \
+      FCL_ALLOCATOR_LL_DEFAULT_ALLOCATIONS, sizeof(*a->allocations)); \
   if (!a->allocations)  \
     return -1;  \
-  new_structs = aligned_alloc(LEVEL1_DCACHE_LINESIZE, \
-                              sizeof(*new_structs) * initial_size); \
-  if (!new_structs) \
-    return -1;  \
-  a->allocations[0] = new_structs;  \
+  a->backend = backend; \
+  a->slab_flags = slab_flags; \
+  memset(&a->stats, 0, sizeof(a->stats)); \
+  _FCL_ALLOCATOR_##remote_mode##_INIT(a, field_type); \
   name##_free_list_head_init(&a->free_list); \
-  a->free_count = initial_size;  \
-  a->total_count = initial_size; \
+  a->free_count = 0;  \
+  a->total_count = 0; \
+  a->carve_next = NULL; \
+  a->carve_end = NULL;  \
   a->elem_init = elem_init;  \
+  a->free_init = elem_init;  \
+  a->borrow_init = NULL;  \
+  a->prototype = NULL;  \
+  name##_free_list_head_init(&a->dirty_list); \
+  a->dirty_count = 0; \
+  a->init_policy = FCL_ALLOCATOR_INIT_POLICY_ON_RETURN; \
   a->oom_policy = oom_policy; \
+  assert(_FCL_ALLOCATOR_OOM_##oom_mode(a) == oom_policy); \
   a->num_allocations = FCL_ALLOCATOR_LL_DEFAULT_ALLOCATIONS;  \
-  switch(a->oom_policy) { \
+  a->num_slabs = 0; \
+  switch(_FCL_ALLOCATOR_OOM_##oom_mode(a)) { \
     case FCL_ALLOCATOR_OOM_POLICY_DOUBLE:  \
       a->increment = initial_size; \
       break;  \
@@ -120,83 +644,316 @@ int name##_allocator_init(struct name##_allocator *a, size_t initial_size, \
     default:  \
       a->increment = 0; \
   } \
-  for (i=0; i < initial_size; i++) {\
-    if (a->elem_init) \
-      a->elem_init(&new_structs[i]);  \
-    name##_free_list_insert(&a->free_list, &new_structs[i]); \
+  if (_##name##_allocator_allocate(a, initial_size) != 1) { \
+    free(a->allocations); \
+    return -1;  \
   } \
   return 1; \
 } \
-void name##_allocator_freeall(struct name##_allocator *a) { \
+scope void name##_allocator_freeall(struct name##_allocator *a) { \
   assert(a);  \
   assert(a->allocations); \
   size_t i; \
-  for (i=0; a->allocations[i]; i++) \
-    free(a->allocations[i]);  \
+  for (i=0; i < a->num_slabs; i++)  \
+    fcl_allocator_slab_free(&a->allocations[i]);  \
   free(a->allocations); \
 } \
-int _##name##_allocator_allocate(struct name##_allocator *a) { \
+scope int _##name##_allocator_allocate( \
+    struct name##_allocator *a, size_t count) { \
   assert(a);  \
+  struct fcl_allocator_slab slab;  \
   type *new_structs;  \
   size_t i; \
-  new_structs = aligned_alloc(LEVEL1_DCACHE_LINESIZE, \
-                              sizeof(*new_structs) * a->increment); \
-  if (!new_structs) \
+  uint64_t ns = _FCL_ALLOCATOR_STATS_NOW(); \
+  if (a->num_slabs == a->num_allocations) { \
+    void *new_allocations = realloc(a->allocations, \
+                                    sizeof(*a->allocations) * \
+                                    a->num_allocations * 2);  \
+    if (!new_allocations) { \
+      _FCL_ALLOCATOR_STATS_ADD(a, failed_grows, 1); \
+      FCL_ALLOCATOR_TRACE_GROW(a, count, 0, 0); \
+      return -1;  \
+    } \
+    a->allocations = (struct fcl_allocator_slab *)new_allocations; \
+    a->num_allocations *= 2;  \
+  } \
+  if (fcl_allocator_slab_alloc(&slab, sizeof(type) * count, a->backend, \
+                               a->slab_flags) != 1) { \
+    _FCL_ALLOCATOR_STATS_ADD(a, failed_grows, 1); \
+    FCL_ALLOCATOR_TRACE_GROW(a, count, 0, 0); \
     return -1;  \
-  for (i=0; i < a->increment; i++) \
-    name##_free_list_insert(&a->free_list, &new_structs[i]); \
-  for (i=0; i < a->num_allocations; i++) {  \
-    if (a->allocations[i])  \
-      continue; \
-    a->allocations[i] = new_structs;  \
-    a->total_count += a->increment; \
-    a->free_count += a->increment;  \
-    return 1; \
   } \
-  void *new_allocations = realloc(a->allocations, sizeof(type*) * \
-                                  a->num_allocations * 2);  \
-  if (new_allocations) {  \
-    a->num_allocations *= 2;  \
-    a->allocations = new_allocations; \
-    a->total_count += a->increment; \
-    a->free_count += a->increment;  \
-    a->allocations[i+1] = new_structs;  \
-    for (i = i+2; i < a->num_allocations; i++) \
-      a->allocations[i] = NULL; \
-    return 1; \
-  } else {  \
-    free(new_structs);  \
-    return -1; \
+  slab.count = count = slab.bytes / sizeof(type); \
+  for (i = a->num_slabs; i > 0 && \
+       (uintptr_t)a->allocations[i-1].mem > (uintptr_t)slab.mem; i--) \
+    a->allocations[i] = a->allocations[i-1];  \
+  a->allocations[i] = slab; \
+  a->num_slabs++; \
+  a->backend = slab.backend;  \
+  a->slab_flags = slab.flags; \
+  new_structs = (type*)slab.mem; \
+  while (a->carve_next != a->carve_end) \
+    name##_free_list_insert(&a->free_list, _##name##_allocator_carve(a)); \
+  a->carve_next = new_structs;  \
+  a->carve_end = new_structs + count; \
+  a->total_count += count;  \
+  a->free_count += count; \
+  ns = _FCL_ALLOCATOR_STATS_NOW() - ns; \
+  _FCL_ALLOCATOR_STATS_GROW(a, ns); \
+  FCL_ALLOCATOR_TRACE_GROW(a, count, ns, 1); \
+  (void)ns; \
+  return 1; \
+} \
+scope int _##name##_allocator_grow(struct name##_allocator *a, size_t need) { \
+  assert(a);  \
+  size_t count; \
+  if (a->increment == 0)  \
+    a->increment = need;  \
+  switch(_FCL_ALLOCATOR_OOM_##oom_mode(a)) { \
+    case FCL_ALLOCATOR_OOM_POLICY_DOUBLE: \
+      while (a->increment < need) \
+        a->increment *= 2;  \
+      if (_##name##_allocator_allocate(a, a->increment) != 1) \
+        return -1;  \
+      a->increment *= 2;  \
+      return 1; \
+    case FCL_ALLOCATOR_OOM_POLICY_INCREMENTAL: \
+      count = (need + a->increment - 1) / a->increment * a->increment; \
+      return _##name##_allocator_allocate(a, count);  \
+    default:  \
+      return -1;  \
   } \
 } \
-type *name##_allocator_borrow(struct name##_allocator *a) {  \
+scope type *_##name##_allocator_carve(struct name##_allocator *a) { \
   assert(a);  \
-  type *new_struct; \
-  if (a->free_count == 0) { \
-    switch(a->oom_policy) { \
-      case FCL_ALLOCATOR_OOM_POLICY_DOUBLE: \
-        if (_##name##_allocator_allocate(a) == 1) \
-          a->increment *= 2;  \
-        break;  \
-      case FCL_ALLOCATOR_OOM_POLICY_INCREMENTAL: \
-        _##name##_allocator_allocate(a);  \
-        break;  \
-      default:  \
-        return NULL;  \
+  assert(a->carve_next != a->carve_end);  \
+  type *new_struct = a->carve_next++; \
+  if (a->free_init) \
+    a->free_init(new_struct); \
+  return new_struct;  \
+} \
+scope type *_##name##_allocator_take_dirty(struct name##_allocator *a) { \
+  assert(a);  \
+  type *e = name##_free_list_remove(&a->dirty_list);  \
+  if (!e) \
+    return NULL;  \
+  a->dirty_count--; \
+  if (a->free_init) \
+    a->free_init(e);  \
+  return e; \
+} \
+scope void _##name##_allocator_borrow_init(struct name##_allocator *a, \
+                                           type *e) { \
+  if (a->borrow_init) \
+    a->borrow_init(e);  \
+  else if (a->prototype)  \
+    memcpy(e, a->prototype, sizeof(type));  \
+} \
+scope size_t name##_allocator_reinit(struct name##_allocator *a, size_t n) { \
+  assert(a);  \
+  type *e;  \
+  size_t i; \
+  for (i=0; i < n && (e = _##name##_allocator_take_dirty(a)); i++) \
+    name##_free_list_insert(&a->free_list, e);  \
+  return i; \
+} \
+scope int name##_allocator_set_init_policy( \
+    struct name##_allocator *a, fcl_allocator_init_policy init_policy, \
+    const type *prototype) { \
+  assert(a);  \
+  field_type *iter, *tmp; \
+  name##_allocator_elem_init_fn old_free_init = a->free_init; \
+  if (init_policy == FCL_ALLOCATOR_INIT_POLICY_PROTOTYPE && !prototype) \
+    return -1;  \
+  (void)_FCL_ALLOCATOR_##remote_mode##_RECLAIM(name, a); \
+  name##_allocator_reinit(a, SIZE_MAX); \
+  a->init_policy = init_policy; \
+  a->free_init = init_policy == FCL_ALLOCATOR_INIT_POLICY_ON_RETURN || \
+                 init_policy == FCL_ALLOCATOR_INIT_POLICY_DEFERRED ? \
+                 a->elem_init : NULL; \
+  a->borrow_init = init_policy == FCL_ALLOCATOR_INIT_POLICY_ON_BORROW ? \
+                   a->elem_init : NULL; \
+  a->prototype = init_policy == FCL_ALLOCATOR_INIT_POLICY_PROTOTYPE ? \
+                 prototype : NULL;  \
+  if (a->free_init && !old_free_init) \
+    FCL_LIST_##recycle_policy##_EACH(&a->free_list, iter, tmp) \
+      a->free_init(name##_free_list_get_entry(iter)); \
+  return 1; \
+} \
+_FCL_ALLOCATOR_##remote_mode##_DEFINE(scope, name, type, field_type, field) \
+scope long _##name##_allocator_find_slab(struct name##_allocator *a, \
+                                         const type *e) { \
+  assert(a);  \
+  uintptr_t p = (uintptr_t)e; \
+  size_t lo = 0, hi = a->num_slabs, mid; \
+  while (lo < hi) { \
+    mid = lo + (hi - lo) / 2; \
+    if ((uintptr_t)a->allocations[mid].mem <= p)  \
+      lo = mid + 1; \
+    else  \
+      hi = mid; \
+  } \
+  if (lo == 0 || p >= (uintptr_t)((type*)a->allocations[lo-1].mem + \
+                                  a->allocations[lo-1].count))  \
+    return -1;  \
+  return lo - 1;  \
+} \
+scope size_t name##_allocator_trim(struct name##_allocator *a, size_t keep) { \
+  assert(a);  \
+  struct name##_free_list_head kept;  \
+  field_type *iter, *tmp; \
+  size_t *free_in, released, i, j; \
+  type *e;  \
+  (void)_FCL_ALLOCATOR_##remote_mode##_RECLAIM(name, a); \
+  name##_allocator_reinit(a, SIZE_MAX); \
+  if (a->free_count <= keep || a->num_slabs == 0) \
+    return 0; \
+  free_in = (size_t *)calloc(a->num_slabs, sizeof(*free_in)); \
+  if (!free_in) \
+    return 0; \
+  FCL_LIST_##recycle_policy##_EACH(&a->free_list, iter, tmp) { \
+    e = name##_free_list_get_entry(iter); \
+    free_in[_##name##_allocator_find_slab(a, e)]++; \
+  } \
+  if (a->carve_next != a->carve_end)  \
+    free_in[_##name##_allocator_find_slab(a, a->carve_next)] += \
+        a->carve_end - a->carve_next; \
+  released = 0; \
+  for (i=0; i < a->num_slabs; i++) {  \
+    if (free_in[i] == a->allocations[i].count && \
+        a->free_count - released - free_in[i] >= keep) { \
+      released += free_in[i]; \
+      free_in[i] = SIZE_MAX;  \
     } \
   } \
+  if (!released) {  \
+    free(free_in);  \
+    return 0; \
+  } \
+  name##_free_list_head_init(&kept); \
+  while ((e = name##_free_list_remove(&a->free_list)))  \
+    if (free_in[_##name##_allocator_find_slab(a, e)] != SIZE_MAX) \
+      name##_free_list_insert(&kept, e); \
+  while ((e = name##_free_list_remove(&kept))) \
+    name##_free_list_insert(&a->free_list, e); \
+  if (a->carve_next != a->carve_end &&  \
+      free_in[_##name##_allocator_find_slab(a, a->carve_next)] == SIZE_MAX) \
+    a->carve_next = a->carve_end = NULL;  \
+  for (i=0, j=0; i < a->num_slabs; i++) { \
+    if (free_in[i] == SIZE_MAX) \
+      fcl_allocator_slab_free(&a->allocations[i]);  \
+    else  \
+      a->allocations[j++] = a->allocations[i];  \
+  } \
+  a->num_slabs = j; \
+  a->free_count -= released;  \
+  a->total_count -= released; \
+  free(free_in);  \
+  return released;  \
+} \
+scope type *name##_allocator_borrow(struct name##_allocator *a) {  \
+  assert(a);  \
+  type *new_struct; \
+  if (FCL_UNLIKELY(a->free_count == 0) && \
+      !_FCL_ALLOCATOR_##remote_mode##_RECLAIM(name, a) && \
+      _##name##_allocator_grow(a, 1) != 1) { \
+    _FCL_ALLOCATOR_STATS_ADD(a, failed_borrows, 1); \
+    return NULL;  \
+  } \
   new_struct = name##_free_list_remove(&a->free_list);  \
-  if (new_struct) \
-    a->free_count--;  \
+  if (!new_struct && !(new_struct = _##name##_allocator_take_dirty(a))) \
+    new_struct = _##name##_allocator_carve(a);  \
+  a->free_count--;  \
+  _##name##_allocator_borrow_init(a, new_struct); \
+  _FCL_ALLOCATOR_STATS_ADD(a, borrows, 1);  \
+  _FCL_ALLOCATOR_STATS_HWM(a);  \
   return new_struct;  \
 } \
-void name##_allocator_return(struct name##_allocator *a, type *e) {  \
+scope size_t _##name##_allocator_take_bulk( \
+    struct name##_allocator *a, type **out, size_t n) { \
+  assert(a);  \
+  assert(out);  \
+  size_t i; \
+  if (a->free_count < n)  \
+    (void)_FCL_ALLOCATOR_##remote_mode##_RECLAIM(name, a); \
+  if (a->free_count < n)  \
+    _##name##_allocator_grow(a, n - a->free_count);  \
+  if (n > a->free_count)  \
+    n = a->free_count;  \
+  for (i=0; i < n && (out[i] = name##_free_list_remove(&a->free_list)); i++) \
+    ; \
+  for (; i < n && (out[i] = _##name##_allocator_take_dirty(a)); i++) \
+    ; \
+  for (; i < n; i++)  \
+    out[i] = _##name##_allocator_carve(a);  \
+  a->free_count -= n; \
+  _FCL_ALLOCATOR_STATS_ADD(a, borrows, n);  \
+  _FCL_ALLOCATOR_STATS_HWM(a);  \
+  return n; \
+} \
+scope size_t name##_allocator_borrow_bulk( \
+    struct name##_allocator *a, type **out, size_t n) { \
+  size_t i; \
+  n = _##name##_allocator_take_bulk(a, out, n); \
+  if (a->borrow_init || a->prototype) \
+    for (i=0; i < n; i++) \
+      _##name##_allocator_borrow_init(a, out[i]); \
+  return n; \
+} \
+scope void name##_allocator_return(struct name##_allocator *a, type *e) {  \
   assert(a);  \
   assert(e);  \
-  if (a->elem_init) \
-    a->elem_init(e);  \
-  name##_free_list_insert(&a->free_list, e);  \
   a->free_count++;  \
+  _FCL_ALLOCATOR_STATS_ADD(a, returns, 1);  \
+  if (a->init_policy == FCL_ALLOCATOR_INIT_POLICY_DEFERRED) { \
+    name##_free_list_insert(&a->dirty_list, e); \
+    a->dirty_count++; \
+    return; \
+  } \
+  if (a->free_init) \
+    a->free_init(e);  \
+  name##_free_list_insert(&a->free_list, e);  \
+} \
+scope void _##name##_allocator_put_bulk(struct name##_allocator *a, \
+                                        type **e, size_t n) { \
+  assert(a);  \
+  assert(e);  \
+  size_t i; \
+  for (i=0; i < n; i++) \
+    name##_free_list_insert(&a->free_list, e[i]); \
+  a->free_count += n; \
+  _FCL_ALLOCATOR_STATS_ADD(a, returns, n);  \
+} \
+scope void name##_allocator_return_bulk(struct name##_allocator *a, type **e, \
+                                        size_t n) { \
+  assert(a);  \
+  assert(e);  \
+  size_t i; \
+  if (a->free_init) \
+    for (i=0; i < n; i++) \
+      a->free_init(e[i]); \
+  _##name##_allocator_put_bulk(a, e, n);  \
+} \
+scope void name##_allocator_return_list( \
+    struct name##_allocator *a, struct name##_free_list_head *l, size_t n) { \
+  assert(a);  \
+  assert(l);  \
+  field_type *iter, *tmp; \
+  if (a->free_init) \
+    FCL_LIST_##recycle_policy##_EACH(l, iter, tmp) \
+      a->free_init(name##_free_list_get_entry(iter)); \
+  _FCL_ALLOCATOR_LL_RECYCLE_ALL_##recycle_policy(name)(&a->free_list, l);  \
+  a->free_count += n; \
+  _FCL_ALLOCATOR_STATS_ADD(a, returns, n);  \
+} \
+scope void name##_allocator_stats(struct name##_allocator *a, \
+                                  struct fcl_allocator_stats *out) { \
+  assert(a);  \
+  assert(out);  \
+  *out = a->stats;  \
+  out->in_use = a->total_count - a->free_count; \
+  out->free = a->free_count;  \
+  out->total = a->total_count;  \
 }
 
 
@@ -0,0 +1,210 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A thread caching front end for FCL_ALLOCATOR_LL.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Requires POSIX threads.
+
+   FCL_ALLOCATOR_TC places a per-thread cache (tcache) of objects in front of
+   a shared depot.  The depot is an FCL_ALLOCATOR_LL allocator guarded by a
+   mutex.  Each thread owns one tcache and borrows from and returns to it
+   without touching any shared state.  Only when a tcache runs dry does it
+   lock the depot and refill a whole magazine of objects, and only when it
+   holds two magazines worth of objects does it lock the depot and flush one
+   magazine back.  The lock is therefore taken at most once every
+   magazine_size operations per thread.
+
+   A tcache is NOT thread safe and must only be used by the thread that owns
+   it.  Objects may be borrowed from one tcache and returned to another tcache
+   of the same depot.  Before a thread exits it should call
+   name##_tcache_flush to hand its cached objects back to the depot.
+
+   The hit/miss counters in the tcache count the borrows served from the
+   cache, the borrows that had to refill from the depot, the returns kept in
+   the cache, and the returns that had to flush to the depot.  A miss rate
+   well above 1/magazine_size means the magazine is too small for the
+   workload.
+
+   The init policy of the depot's FCL_ALLOCATOR_LL is kept: a tcache
+   initializes objects as they are returned to it, or as they are borrowed
+   from it, as the allocator would.  A tcache has no dirty list, so under
+   DEFERRED it initializes on return like ON_RETURN; under both, every object
+   held by a tcache or the depot is in the initialized state.  Each tcache
+   copies the policy when it is initialized and never reads it from the
+   depot again, so the policy must be set with
+   name##_allocator_set_init_policy(&d->allocator, ...) before the first
+   tcache of the depot is initialized, and not changed while any tcache of
+   the depot is in use.
+
+   Refills and flushes go through the allocator's bulk borrow and return
+   paths under the depot lock, so with -DFCL_ALLOCATOR_STATS the depot
+   counts the objects handed to and taken back from the tcaches.
+*/
+
+#ifndef _FCL_ALLOCATOR_TC_H_
+#define _FCL_ALLOCATOR_TC_H_
+
+#include <pthread.h>    // pthread_mutex_t
+#include "fcl_allocator.h"
+
+#define FCL_ALLOCATOR_TC_DEFAULT_MAGAZINE_SIZE 64
+
+
+// name = allocator prefix, must match an FCL_ALLOCATOR_LL of the same name
+// type = container type, eg struct my_node
+// field_type = the list link(s) type, eg struct fcl_list_links
+// field = the name of the field_type struct in the container, eg links
+// example usage:
+// FCL_ALLOCATOR_LL_DECLARE(node, struct my_node, struct fcl_list_links, links,
+//                          LIFO)
+// FCL_ALLOCATOR_TC_DECLARE(node, struct my_node, struct fcl_list_links, links)
+#define FCL_ALLOCATOR_TC_DECLARE(name, type, field_type, field) \
+FCL_LIST_LIFO_DECLARE(name##_mag, type, field_type, field) \
+struct name##_depot { \
+  struct name##_allocator allocator;  \
+  pthread_mutex_t lock; \
+  size_t magazine_size; \
+};  \
+struct name##_tcache {  \
+  struct name##_mag_list_head objs; \
+  size_t count; \
+  size_t magazine_size; \
+  struct name##_depot *depot; \
+  name##_allocator_elem_init_fn free_init;  \
+  name##_allocator_elem_init_fn borrow_init;  \
+  const type *prototype;  \
+  size_t borrow_hits; \
+  size_t borrow_misses; \
+  size_t return_hits; \
+  size_t return_misses; \
+};  \
+int name##_depot_init(struct name##_depot *d, size_t initial_size, \
+                      fcl_allocator_oom_policy oom_policy, size_t inc, \
+                      name##_allocator_elem_init_fn elem_init, \
+                      size_t magazine_size);  \
+void name##_depot_freeall(struct name##_depot *d);  \
+void name##_tcache_init(struct name##_tcache *tc, struct name##_depot *d); \
+void _##name##_tcache_release(struct name##_tcache *tc, size_t n); \
+void _##name##_tcache_borrow_init(struct name##_tcache *tc, type *e); \
+void name##_tcache_flush(struct name##_tcache *tc);  \
+type *name##_tcache_borrow(struct name##_tcache *tc);  \
+void name##_tcache_return(struct name##_tcache *tc, type *e);
+
+#define FCL_ALLOCATOR_TC_DEFINE(name, type, field_type, field) \
+FCL_LIST_LIFO_DEFINE(name##_mag, type, field_type, field) \
+int name##_depot_init(struct name##_depot *d, size_t initial_size, \
+                      fcl_allocator_oom_policy oom_policy, size_t inc, \
+                      name##_allocator_elem_init_fn elem_init, \
+                      size_t magazine_size) { \
+  assert(d);  \
+  if (pthread_mutex_init(&d->lock, NULL) != 0) \
+    return -1;  \
+  if (name##_allocator_init(&d->allocator, initial_size, oom_policy, inc, \
+                            elem_init) != 1) { \
+    pthread_mutex_destroy(&d->lock);  \
+    return -1;  \
+  } \
+  d->magazine_size = magazine_size ? magazine_size : \
+                     FCL_ALLOCATOR_TC_DEFAULT_MAGAZINE_SIZE;  \
+  return 1; \
+} \
+void name##_depot_freeall(struct name##_depot *d) { \
+  assert(d);  \
+  name##_allocator_freeall(&d->allocator);  \
+  pthread_mutex_destroy(&d->lock);  \
+} \
+void name##_tcache_init(struct name##_tcache *tc, struct name##_depot *d) { \
+  assert(tc); \
+  assert(d);  \
+  name##_mag_list_head_init(&tc->objs); \
+  tc->count = 0;  \
+  tc->magazine_size = d->magazine_size; \
+  tc->depot = d;  \
+  pthread_mutex_lock(&d->lock); \
+  tc->free_init = d->allocator.free_init; \
+  tc->borrow_init = d->allocator.borrow_init; \
+  tc->prototype = d->allocator.prototype; \
+  pthread_mutex_unlock(&d->lock); \
+  tc->borrow_hits = 0;  \
+  tc->borrow_misses = 0;  \
+  tc->return_hits = 0;  \
+  tc->return_misses = 0;  \
+} \
+void _##name##_tcache_release(struct name##_tcache *tc, size_t n) { \
+  type *batch[FCL_ALLOCATOR_TC_DEFAULT_MAGAZINE_SIZE];  \
+  size_t i; \
+  pthread_mutex_lock(&tc->depot->lock);  \
+  while (n > 0) { \
+    for (i=0; i < n && i < FCL_ALLOCATOR_TC_DEFAULT_MAGAZINE_SIZE && \
+         (batch[i] = name##_mag_list_remove(&tc->objs)); i++) \
+      ; \
+    if (!i) \
+      break;  \
+    _##name##_allocator_put_bulk(&tc->depot->allocator, batch, i); \
+    tc->count -= i; \
+    n -= i; \
+  } \
+  pthread_mutex_unlock(&tc->depot->lock);  \
+} \
+void _##name##_tcache_borrow_init(struct name##_tcache *tc, type *e) { \
+  if (tc->borrow_init)  \
+    tc->borrow_init(e); \
+  else if (tc->prototype) \
+    memcpy(e, tc->prototype, sizeof(type)); \
+} \
+void name##_tcache_flush(struct name##_tcache *tc) { \
+  assert(tc); \
+  _##name##_tcache_release(tc, tc->count);  \
+} \
+type *name##_tcache_borrow(struct name##_tcache *tc) {  \
+  assert(tc); \
+  type *batch[FCL_ALLOCATOR_TC_DEFAULT_MAGAZINE_SIZE], *e; \
+  size_t i, n, want; \
+  if (tc->count) {  \
+    tc->borrow_hits++;  \
+    tc->count--;  \
+    e = name##_mag_list_remove(&tc->objs);  \
+    _##name##_tcache_borrow_init(tc, e);  \
+    return e; \
+  } \
+  tc->borrow_misses++;  \
+  pthread_mutex_lock(&tc->depot->lock);  \
+  for (want = tc->magazine_size; want > 0; want -= n) { \
+    n = want < FCL_ALLOCATOR_TC_DEFAULT_MAGAZINE_SIZE ? want : \
+        FCL_ALLOCATOR_TC_DEFAULT_MAGAZINE_SIZE; \
+    n = _##name##_allocator_take_bulk(&tc->depot->allocator, batch, n); \
+    if (!n) \
+      break;  \
+    for (i=0; i < n; i++) \
+      name##_mag_list_insert(&tc->objs, batch[i]); \
+    tc->count += n; \
+  } \
+  pthread_mutex_unlock(&tc->depot->lock);  \
+  if (!tc->count) \
+    return NULL;  \
+  tc->count--;  \
+  e = name##_mag_list_remove(&tc->objs);  \
+  _##name##_tcache_borrow_init(tc, e);  \
+  return e; \
+} \
+void name##_tcache_return(struct name##_tcache *tc, type *e) {  \
+  assert(tc); \
+  assert(e);  \
+  if (tc->free_init)  \
+    tc->free_init(e); \
+  name##_mag_list_insert(&tc->objs, e);  \
+  tc->count++;  \
+  if (tc->count < 2 * tc->magazine_size) {  \
+    tc->return_hits++;  \
+    return; \
+  } \
+  tc->return_misses++;  \
+  _##name##_tcache_release(tc, tc->magazine_size);  \
+}
+
+
+
+#endif  // _FCL_ALLOCATOR_TC_H_
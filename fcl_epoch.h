@@ -0,0 +1,276 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only epoch-based reclamation library.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Requires C11 atomics.
+
+   A read-mostly list can be walked by many threads without locks as long as
+   a node removed by a writer is not reused while a reader may still hold
+   it.  Returning the node to its FCL_ALLOCATOR_LL right away would let the
+   allocator run elem_init over it, or hand it out again, under the reader.
+   Epoch-based reclamation defers the return until every reader that might
+   have seen the node has left its read-side critical section.
+
+   An fcl_epoch domain holds a global epoch and one record per thread.  Each
+   reader thread registers once with fcl_epoch_register and brackets every
+   traversal with fcl_epoch_enter and fcl_epoch_exit, which announce and
+   clear the epoch it read in; a critical section should be short, and may
+   not nest.  The global epoch only advances (fcl_epoch_try_advance) when
+   every active reader has announced the current epoch.  A node unlinked
+   while the global epoch was E can therefore no longer be reached by any
+   reader once the global epoch is E + 2.
+
+   FCL_EPOCH_XXX macros generate a limbo for a container type.  A writer
+   unlinks a node and passes it to name##_epoch_retire, which keeps it on
+   one of three lists by epoch.  Retire tries to advance the epoch and frees
+   the lists that became safe every FCL_EPOCH_COLLECT_THRESHOLD nodes, and
+   name##_epoch_collect does the same on demand.  Nodes are freed through a
+   user supplied callback and context, like the eviction callback of
+   fcl_lru.h:
+     void free_node(struct obj *o, void *ctx) { obj_allocator_return(ctx, o); }
+   The limbo needs a link of its own in the container, since readers may
+   still follow the list links of a retired node.  Each limbo belongs to
+   one writer thread; several writers use one limbo each, in one domain.
+
+   A writer and concurrent readers must access the links through atomics.
+   FCL_EPOCH_LOAD_NEXT and FCL_EPOCH_STORE_NEXT read and publish the next
+   pointer of any fcl link struct.  fcl_epoch_dl_insert_after and
+   fcl_epoch_dl_remove relink an FCL_LIST_DL list so that readers may walk
+   it forward with FCL_EPOCH_DL_EACH while a single writer (or writers
+   serialized by a lock) modifies it; a removed node keeps its next pointer
+   so a reader standing on it can continue.  Readers must not use prev.
+*/
+
+#ifndef _FCL_EPOCH_H_
+#define _FCL_EPOCH_H_
+
+#include <assert.h>     // assert
+#include <stdint.h>     // uint64_t
+#include <stdatomic.h>  // atomic_load_explicit
+#include "fcl_list.h"
+#include "fcl_macro.h"
+
+#ifndef FCL_EPOCH_MAX_THREADS
+#define FCL_EPOCH_MAX_THREADS 64
+#endif
+
+#ifndef FCL_EPOCH_COLLECT_THRESHOLD
+#define FCL_EPOCH_COLLECT_THRESHOLD 64
+#endif
+
+#define FCL_EPOCH_BUCKETS 3
+
+// a record's epoch is (epoch << 1) | FCL_EPOCH_ACTIVE while in a section
+#define FCL_EPOCH_ACTIVE 1
+
+
+// reads the next pointer of the link @l of type @field_type, which a writer
+// may publish concurrently
+#define FCL_EPOCH_LOAD_NEXT(field_type, l) \
+  atomic_load_explicit((_Atomic(field_type *) *)&(l)->next, \
+                       memory_order_acquire)
+
+// publishes @v as the next pointer of the link @l of type @field_type
+#define FCL_EPOCH_STORE_NEXT(field_type, l, v) \
+  atomic_store_explicit((_Atomic(field_type *) *)&(l)->next, (v), \
+                        memory_order_release)
+
+// walks an FCL_LIST_DL list inside a read-side critical section
+// l = ptr to the fcl_list_links sentinel
+// i = fcl_list_links ptr
+#define FCL_EPOCH_DL_EACH(l, i)                                        \
+  for (i = FCL_EPOCH_LOAD_NEXT(struct fcl_list_links, l); i != (l);    \
+       i = FCL_EPOCH_LOAD_NEXT(struct fcl_list_links, i))
+
+
+struct fcl_epoch_record {
+  _Alignas(LEVEL1_DCACHE_LINESIZE) _Atomic(uint64_t) epoch;
+  atomic_int in_use;
+};
+
+struct fcl_epoch {
+  _Alignas(LEVEL1_DCACHE_LINESIZE) _Atomic(uint64_t) global;
+  struct fcl_epoch_record records[FCL_EPOCH_MAX_THREADS];
+};
+
+static inline void fcl_epoch_init(struct fcl_epoch *d) {
+  assert(d);
+  int i;
+  atomic_init(&d->global, 0);
+  for (i=0; i < FCL_EPOCH_MAX_THREADS; i++) {
+    atomic_init(&d->records[i].epoch, 0);
+    atomic_init(&d->records[i].in_use, 0);
+  }
+}
+
+// claims a record for the calling thread, or returns NULL if all
+// FCL_EPOCH_MAX_THREADS records are in use
+static inline struct fcl_epoch_record *fcl_epoch_register(
+    struct fcl_epoch *d) {
+  assert(d);
+  int i, expected;
+  for (i=0; i < FCL_EPOCH_MAX_THREADS; i++) {
+    expected = 0;
+    if (atomic_compare_exchange_strong(&d->records[i].in_use, &expected, 1))
+      return &d->records[i];
+  }
+  return NULL;
+}
+
+static inline void fcl_epoch_unregister(struct fcl_epoch_record *r) {
+  assert(r);
+  assert(!(atomic_load(&r->epoch) & FCL_EPOCH_ACTIVE));
+  atomic_store_explicit(&r->in_use, 0, memory_order_release);
+}
+
+// starts a read-side critical section
+static inline void fcl_epoch_enter(struct fcl_epoch *d,
+                                   struct fcl_epoch_record *r) {
+  assert(d);
+  assert(r);
+  uint64_t g = atomic_load_explicit(&d->global, memory_order_relaxed);
+  atomic_store_explicit(&r->epoch, (g << 1) | FCL_EPOCH_ACTIVE,
+                        memory_order_relaxed);
+  // the announcement must be visible before any list pointer is read
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+// ends a read-side critical section
+static inline void fcl_epoch_exit(struct fcl_epoch_record *r) {
+  assert(r);
+  atomic_store_explicit(&r->epoch, 0, memory_order_release);
+}
+
+// advances the global epoch if every active reader has announced it
+// returns 1 if the global epoch moved on, by this call or another, else 0
+static inline int fcl_epoch_try_advance(struct fcl_epoch *d) {
+  assert(d);
+  uint64_t g, e;
+  int i;
+  g = atomic_load(&d->global);
+  for (i=0; i < FCL_EPOCH_MAX_THREADS; i++) {
+    if (!atomic_load_explicit(&d->records[i].in_use, memory_order_relaxed))
+      continue;
+    e = atomic_load(&d->records[i].epoch);
+    if ((e & FCL_EPOCH_ACTIVE) && (e >> 1) != g)
+      return 0;
+  }
+  atomic_compare_exchange_strong(&d->global, &g, g + 1);
+  return 1;
+}
+
+// inserts @n after @pos in an FCL_LIST_DL list walked by readers
+static inline void fcl_epoch_dl_insert_after(struct fcl_list_links *pos,
+                                             struct fcl_list_links *n) {
+  assert(pos);
+  assert(n);
+  n->next = pos->next;
+  n->prev = pos;
+  pos->next->prev = n;
+  FCL_EPOCH_STORE_NEXT(struct fcl_list_links, pos, n);
+}
+
+// unlinks @n from an FCL_LIST_DL list walked by readers; n->next is kept
+static inline void fcl_epoch_dl_remove(struct fcl_list_links *n) {
+  assert(n);
+  FCL_EPOCH_STORE_NEXT(struct fcl_list_links, n->prev, n->next);
+  n->next->prev = n->prev;
+}
+
+
+// name = limbo prefix, eg routes
+// type = container type, eg struct route
+// field_type = the limbo link type, eg struct fcl_list_link
+// field = name of the field_type struct in the container, eg rlink
+#define FCL_EPOCH_DECLARE(name, type, field_type, field) \
+FCL_LIST_FIFO_DECLARE(name##_limbo, type, field_type, field)  \
+typedef void (*name##_epoch_free_fn)(type *e, void *ctx); \
+struct name##_epoch_limbo { \
+  struct fcl_epoch *domain; \
+  struct name##_limbo_list_head lists[FCL_EPOCH_BUCKETS]; \
+  uint64_t epochs[FCL_EPOCH_BUCKETS]; \
+  size_t pending; \
+  name##_epoch_free_fn free_fn; \
+  void *free_ctx; \
+};  \
+void name##_epoch_limbo_init(struct name##_epoch_limbo *l, \
+                             struct fcl_epoch *domain, \
+                             name##_epoch_free_fn free_fn, void *free_ctx); \
+size_t name##_epoch_pending(struct name##_epoch_limbo *l); \
+size_t _##name##_epoch_free_list(struct name##_epoch_limbo *l, int b); \
+size_t name##_epoch_collect(struct name##_epoch_limbo *l); \
+void name##_epoch_retire(struct name##_epoch_limbo *l, type *e); \
+void name##_epoch_drain(struct name##_epoch_limbo *l);
+
+#define FCL_EPOCH_DEFINE(name, type, field_type, field) \
+FCL_LIST_FIFO_DEFINE(name##_limbo, type, field_type, field) \
+void name##_epoch_limbo_init(struct name##_epoch_limbo *l, \
+                             struct fcl_epoch *domain, \
+                             name##_epoch_free_fn free_fn, void *free_ctx) { \
+  assert(l);  \
+  assert(domain); \
+  assert(free_fn);  \
+  int b;  \
+  l->domain = domain; \
+  for (b=0; b < FCL_EPOCH_BUCKETS; b++) { \
+    name##_limbo_list_head_init(&l->lists[b]);  \
+    l->epochs[b] = 0; \
+  } \
+  l->pending = 0; \
+  l->free_fn = free_fn; \
+  l->free_ctx = free_ctx; \
+} \
+size_t name##_epoch_pending(struct name##_epoch_limbo *l) { \
+  assert(l);  \
+  return l->pending;  \
+} \
+size_t _##name##_epoch_free_list(struct name##_epoch_limbo *l, int b) { \
+  type *e;  \
+  size_t n = 0; \
+  while ((e = name##_limbo_list_remove(&l->lists[b]))) {  \
+    l->free_fn(e, l->free_ctx); \
+    n++;  \
+  } \
+  l->pending -= n;  \
+  return n; \
+} \
+size_t name##_epoch_collect(struct name##_epoch_limbo *l) { \
+  assert(l);  \
+  uint64_t g = atomic_load(&l->domain->global); \
+  size_t n = 0; \
+  int b;  \
+  for (b=0; b < FCL_EPOCH_BUCKETS; b++) \
+    if (!name##_limbo_list_is_empty(&l->lists[b]) && \
+        l->epochs[b] + 2 <= g)  \
+      n += _##name##_epoch_free_list(l, b); \
+  return n; \
+} \
+void name##_epoch_retire(struct name##_epoch_limbo *l, type *e) { \
+  assert(l);  \
+  assert(e);  \
+  uint64_t g = atomic_load(&l->domain->global); \
+  int b = g % FCL_EPOCH_BUCKETS;  \
+  if (l->epochs[b] != g) {  \
+    _##name##_epoch_free_list(l, b);  \
+    l->epochs[b] = g; \
+  } \
+  name##_limbo_list_insert(&l->lists[b], e);  \
+  if (++l->pending >= FCL_EPOCH_COLLECT_THRESHOLD) {  \
+    fcl_epoch_try_advance(l->domain); \
+    name##_epoch_collect(l);  \
+  } \
+} \
+void name##_epoch_drain(struct name##_epoch_limbo *l) { \
+  assert(l);  \
+  while (l->pending) {  \
+    fcl_epoch_try_advance(l->domain); \
+    name##_epoch_collect(l);  \
+  } \
+}
+
+
+#endif  // _FCL_EPOCH_H_
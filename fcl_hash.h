@@ -0,0 +1,264 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only intrusive chained hash table.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Allocation and deallocation of entries are not managed by this library and
+   are the responsibility of the caller.
+   This library is NOT thread safe.
+
+   The fcl_list_link struct, together with FCL_HASH_XXX macros implement a
+   hash table whose buckets are singly-linked chains threaded through an
+   fcl_list_link embedded in each entry.  The key is a field of the entry, so
+   inserting an entry never allocates, and entries owned by an
+   FCL_ALLOCATOR_LL can be indexed directly (using a link other than the one
+   the allocator uses for its free list).  Only the bucket array is allocated
+   by the table.
+
+   The number of buckets is a power of two, so a bucket is selected by masking
+   the hash.  The table doubles when the number of entries exceeds the number
+   of buckets.  Resizing is incremental: the new bucket array is allocated and
+   every following insert and remove moves FCL_HASH_MIGRATE_STEP buckets of
+   the old array to the new one, so no single insert rehashes the whole table.
+   While a resize is in progress, an entry lives in the old array if its old
+   bucket has not been migrated yet, and in the new array otherwise.  The
+   migration always completes before the table would grow again.
+
+   Keys are compared with eq_fn and hashed with hash_fn, either of which may
+   be a function or a function-like macro.  fcl_hash_u64 and fcl_hash_str are
+   provided for integer and string keys.  Duplicate keys are allowed; find
+   returns the most recently inserted entry with the key.  A migrated chain
+   is split in order into its two new buckets, so this holds across resizes.
+*/
+
+#ifndef _FCL_HASH_H_
+#define _FCL_HASH_H_
+
+#include <assert.h>   // assert
+#include <stddef.h>   // offsetof
+#include <stdint.h>   // uint64_t
+#include <stdlib.h>   // calloc
+#include <string.h>   // strcmp
+#include "fcl_list.h"
+#include "fcl_macro.h"
+
+#define FCL_HASH_MIGRATE_STEP 2
+#define FCL_HASH_DEFAULT_BUCKETS 16
+
+// a mixing function for integer keys (the murmur3 finalizer)
+static inline size_t fcl_hash_u64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return (size_t)k;
+}
+
+// FNV-1a for NUL-terminated string keys
+static inline size_t fcl_hash_str(const char *s) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (; *s; s++) {
+    h ^= (unsigned char)*s;
+    h *= 0x100000001b3ull;
+  }
+  return (size_t)h;
+}
+
+static inline int fcl_hash_str_eq(const char *a, const char *b) {
+  return strcmp(a, b) == 0;
+}
+
+#define FCL_HASH_EQ(a, b) ((a) == (b))
+
+
+// name = table prefix, eg conns
+// type = container type, eg struct conn
+// key_type = type of the key field, eg uint64_t
+// link_field = name of the struct fcl_list_link in the container, eg hlink
+// key_field = name of the key in the container, eg id
+// hash_fn = size_t hash_fn(key_type), eg fcl_hash_u64
+// eq_fn = int eq_fn(key_type, key_type), eg FCL_HASH_EQ
+#define FCL_HASH_DECLARE(name, type, key_type, link_field, key_field, \
+                         hash_fn, eq_fn) \
+struct name##_hash {  \
+  struct fcl_list_link **buckets; \
+  size_t mask;  \
+  struct fcl_list_link **old_buckets; \
+  size_t old_mask;  \
+  size_t migrate_pos; \
+  size_t count; \
+};  \
+int name##_hash_init(struct name##_hash *h, size_t initial_buckets); \
+void name##_hash_freeall(struct name##_hash *h); \
+type *name##_hash_get_entry(struct fcl_list_link *l); \
+size_t name##_hash_count(struct name##_hash *h); \
+struct fcl_list_link **_##name##_hash_bucket(struct name##_hash *h, \
+                                             size_t hash); \
+void _##name##_hash_migrate(struct name##_hash *h, size_t n); \
+void _##name##_hash_grow(struct name##_hash *h); \
+void name##_hash_insert(struct name##_hash *h, type *e); \
+type *name##_hash_find(struct name##_hash *h, key_type key); \
+int name##_hash_remove(struct name##_hash *h, type *e); \
+type *name##_hash_remove_key(struct name##_hash *h, key_type key); \
+struct fcl_list_link *name##_hash_remove_all(struct name##_hash *h);
+
+#define FCL_HASH_DEFINE(name, type, key_type, link_field, key_field, \
+                        hash_fn, eq_fn) \
+int name##_hash_init(struct name##_hash *h, size_t initial_buckets) { \
+  assert(h);  \
+  size_t n = 1; \
+  if (!initial_buckets) \
+    initial_buckets = FCL_HASH_DEFAULT_BUCKETS; \
+  while (n < initial_buckets) \
+    n <<= 1;  \
+  h->buckets = calloc(n, sizeof(*h->buckets)); \
+  if (!h->buckets)  \
+    return -1;  \
+  h->mask = n - 1;  \
+  h->old_buckets = NULL;  \
+  h->old_mask = 0;  \
+  h->migrate_pos = 0; \
+  h->count = 0; \
+  return 1; \
+} \
+void name##_hash_freeall(struct name##_hash *h) { \
+  assert(h);  \
+  free(h->buckets); \
+  free(h->old_buckets); \
+  h->buckets = NULL;  \
+  h->old_buckets = NULL;  \
+  h->mask = 0;  \
+  h->count = 0; \
+} \
+type *name##_hash_get_entry(struct fcl_list_link *l) {  \
+  assert(l);  \
+  return FCL_CONTAINER_OF(l, type, link_field); \
+} \
+size_t name##_hash_count(struct name##_hash *h) { \
+  assert(h);  \
+  return h->count;  \
+} \
+struct fcl_list_link **_##name##_hash_bucket(struct name##_hash *h, \
+                                             size_t hash) { \
+  if (h->old_buckets && (hash & h->old_mask) >= h->migrate_pos) \
+    return &h->old_buckets[hash & h->old_mask]; \
+  return &h->buckets[hash & h->mask]; \
+} \
+void _##name##_hash_migrate(struct name##_hash *h, size_t n) { \
+  struct fcl_list_link *l, *next, **tails[2]; \
+  size_t high; \
+  for (; n > 0 && h->old_buckets; n--) { \
+    high = h->old_mask + 1; \
+    tails[0] = &h->buckets[h->migrate_pos]; \
+    tails[1] = &h->buckets[h->migrate_pos + high]; \
+    for (l = h->old_buckets[h->migrate_pos]; l; l = next) { \
+      next = l->next; \
+      l->next = NULL; \
+      if (hash_fn(name##_hash_get_entry(l)->key_field) & high) { \
+        *tails[1] = l;  \
+        tails[1] = &l->next;  \
+      } else {  \
+        *tails[0] = l;  \
+        tails[0] = &l->next;  \
+      } \
+    } \
+    h->old_buckets[h->migrate_pos] = NULL;  \
+    if (++h->migrate_pos > h->old_mask) { \
+      free(h->old_buckets); \
+      h->old_buckets = NULL;  \
+    } \
+  } \
+} \
+void _##name##_hash_grow(struct name##_hash *h) { \
+  struct fcl_list_link **buckets; \
+  _##name##_hash_migrate(h, SIZE_MAX);  \
+  buckets = calloc(2 * (h->mask + 1), sizeof(*buckets));  \
+  if (!buckets) \
+    return; \
+  h->old_buckets = h->buckets;  \
+  h->old_mask = h->mask;  \
+  h->migrate_pos = 0; \
+  h->buckets = buckets; \
+  h->mask = 2 * h->mask + 1;  \
+} \
+void name##_hash_insert(struct name##_hash *h, type *e) { \
+  assert(h);  \
+  assert(e);  \
+  struct fcl_list_link **b; \
+  _##name##_hash_migrate(h, FCL_HASH_MIGRATE_STEP); \
+  if (h->count > h->mask) \
+    _##name##_hash_grow(h); \
+  b = _##name##_hash_bucket(h, hash_fn(e->key_field)); \
+  e->link_field.next = *b;  \
+  *b = &e->link_field;  \
+  h->count++; \
+} \
+type *name##_hash_find(struct name##_hash *h, key_type key) { \
+  assert(h);  \
+  struct fcl_list_link *l;  \
+  type *e;  \
+  for (l = *_##name##_hash_bucket(h, hash_fn(key)); l; l = l->next) { \
+    e = name##_hash_get_entry(l); \
+    if (eq_fn(e->key_field, key)) \
+      return e; \
+  } \
+  return NULL;  \
+} \
+int name##_hash_remove(struct name##_hash *h, type *e) { \
+  assert(h);  \
+  assert(e);  \
+  struct fcl_list_link **p; \
+  _##name##_hash_migrate(h, FCL_HASH_MIGRATE_STEP); \
+  for (p = _##name##_hash_bucket(h, hash_fn(e->key_field)); *p; \
+       p = &(*p)->next) { \
+    if (*p == &e->link_field) { \
+      *p = e->link_field.next;  \
+      h->count--; \
+      return 1; \
+    } \
+  } \
+  return -1;  \
+} \
+type *name##_hash_remove_key(struct name##_hash *h, key_type key) { \
+  assert(h);  \
+  struct fcl_list_link **p; \
+  type *e;  \
+  _##name##_hash_migrate(h, FCL_HASH_MIGRATE_STEP); \
+  for (p = _##name##_hash_bucket(h, hash_fn(key)); *p; p = &(*p)->next) { \
+    e = name##_hash_get_entry(*p);  \
+    if (eq_fn(e->key_field, key)) { \
+      *p = e->link_field.next;  \
+      h->count--; \
+      return e; \
+    } \
+  } \
+  return NULL;  \
+} \
+struct fcl_list_link *name##_hash_remove_all(struct name##_hash *h) { \
+  assert(h);  \
+  struct fcl_list_link *all = NULL, *l;  \
+  size_t i; \
+  _##name##_hash_migrate(h, SIZE_MAX);  \
+  for (i=0; i <= h->mask; i++) {  \
+    while ((l = h->buckets[i])) { \
+      h->buckets[i] = l->next;  \
+      l->next = all;  \
+      all = l;  \
+    } \
+  } \
+  h->count = 0; \
+  return all; \
+}
+
+// NOTE: it is safe to modify or free entries while iterating with this macro
+// l = the chain returned by name##_hash_remove_all
+// i, tmp = fcl_list_link ptrs
+#define FCL_HASH_CHAIN_EACH(l, i, tmp)                              \
+  for (i = (l); (i) && (tmp = i->next, 1); i = (tmp))
+
+
+#endif  // _FCL_HASH_H_
@@ -0,0 +1,192 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only intrusive priority queue.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Allocation and deallocation are not managed by this library and are the
+   responsibility of the caller.
+   This library is NOT thread safe.
+
+   The fcl_heap_link struct, together with FCL_HEAP_XXX macros implement a
+   pairing heap ordered by a user supplied less-than function.  Each element
+   embeds an fcl_heap_link that points to its leftmost child, its right
+   sibling, and either its left sibling or, for a leftmost child, its parent.
+   Insert and meld are O(1), get_min is O(1), and pop_min is O(log n)
+   amortized.  Because every element is its own handle, decrease_key and
+   remove work on an arbitrary element in O(log n) amortized without
+   searching for it.
+
+   To decrease the key of an element, update its priority first and then call
+   name##_heap_decrease_key.  Increasing a key in place is not supported;
+   remove the element, update it, and insert it again.
+*/
+
+#ifndef _FCL_HEAP_H_
+#define _FCL_HEAP_H_
+
+#include <assert.h>   // assert
+#include <stddef.h>   // offsetof
+#include "fcl_macro.h"
+
+
+struct fcl_heap_link {
+  struct fcl_heap_link *child;
+  struct fcl_heap_link *next;
+  struct fcl_heap_link *prev;
+};
+
+// name = heap prefix, eg timers
+// type = container type, eg struct timer
+// field = name of the fcl_heap_link struct in the container, eg hlink
+// lt_fn = int lt_fn(type *a, type *b), nonzero if a is ordered before b
+#define FCL_HEAP_DECLARE(name, type, field, lt_fn) \
+struct name##_heap {  \
+  struct fcl_heap_link *root; \
+  size_t count; \
+};  \
+void name##_heap_init(struct name##_heap *h); \
+type *name##_heap_get_entry(struct fcl_heap_link *l); \
+int name##_heap_is_empty(struct name##_heap *h); \
+size_t name##_heap_count(struct name##_heap *h); \
+struct fcl_heap_link *_##name##_heap_link(struct fcl_heap_link *a, \
+                                          struct fcl_heap_link *b); \
+struct fcl_heap_link *_##name##_heap_merge_pairs( \
+    struct fcl_heap_link *first); \
+void _##name##_heap_cut(struct fcl_heap_link *l); \
+void name##_heap_insert(struct name##_heap *h, type *e); \
+type *name##_heap_get_min(struct name##_heap *h); \
+type *name##_heap_pop_min(struct name##_heap *h); \
+void name##_heap_decrease_key(struct name##_heap *h, type *e); \
+void name##_heap_remove(struct name##_heap *h, type *e); \
+void name##_heap_meld(struct name##_heap *dst, struct name##_heap *src);
+
+#define FCL_HEAP_DEFINE(name, type, field, lt_fn) \
+void name##_heap_init(struct name##_heap *h) {  \
+  assert(h);  \
+  h->root = NULL; \
+  h->count = 0; \
+} \
+type *name##_heap_get_entry(struct fcl_heap_link *l) {  \
+  assert(l);  \
+  return FCL_CONTAINER_OF(l, type, field);  \
+} \
+int name##_heap_is_empty(struct name##_heap *h) { \
+  assert(h);  \
+  return h->root ? 0 : 1; \
+} \
+size_t name##_heap_count(struct name##_heap *h) { \
+  assert(h);  \
+  return h->count;  \
+} \
+struct fcl_heap_link *_##name##_heap_link(struct fcl_heap_link *a, \
+                                          struct fcl_heap_link *b) {  \
+  struct fcl_heap_link *tmp;  \
+  if (!a) \
+    return b; \
+  if (!b) \
+    return a; \
+  if (lt_fn(name##_heap_get_entry(b), name##_heap_get_entry(a))) { \
+    tmp = a;  \
+    a = b;  \
+    b = tmp;  \
+  } \
+  b->prev = a;  \
+  b->next = a->child; \
+  if (a->child) \
+    a->child->prev = b; \
+  a->child = b; \
+  return a; \
+} \
+struct fcl_heap_link *_##name##_heap_merge_pairs( \
+    struct fcl_heap_link *first) {  \
+  struct fcl_heap_link *a, *b, *stack = NULL, *root;  \
+  while (first) { \
+    a = first;  \
+    b = a->next;  \
+    first = b ? b->next : NULL; \
+    a->next = a->prev = NULL; \
+    if (b) {  \
+      b->next = b->prev = NULL; \
+      a = _##name##_heap_link(a, b);  \
+    } \
+    a->next = stack;  \
+    stack = a;  \
+  } \
+  root = stack; \
+  if (!root)  \
+    return NULL;  \
+  stack = root->next; \
+  root->next = NULL;  \
+  while (stack) { \
+    a = stack;  \
+    stack = a->next;  \
+    a->next = NULL; \
+    root = _##name##_heap_link(root, a);  \
+  } \
+  return root;  \
+} \
+void _##name##_heap_cut(struct fcl_heap_link *l) {  \
+  if (l->prev->child == l)  \
+    l->prev->child = l->next; \
+  else  \
+    l->prev->next = l->next;  \
+  if (l->next)  \
+    l->next->prev = l->prev;  \
+  l->next = l->prev = NULL; \
+} \
+void name##_heap_insert(struct name##_heap *h, type *e) { \
+  assert(h);  \
+  assert(e);  \
+  e->field.child = e->field.next = e->field.prev = NULL;  \
+  h->root = _##name##_heap_link(h->root, &e->field);  \
+  h->count++; \
+} \
+type *name##_heap_get_min(struct name##_heap *h) {  \
+  assert(h);  \
+  if (!h->root) \
+    return NULL;  \
+  return name##_heap_get_entry(h->root);  \
+} \
+type *name##_heap_pop_min(struct name##_heap *h) {  \
+  assert(h);  \
+  struct fcl_heap_link *root = h->root; \
+  if (!root)  \
+    return NULL;  \
+  h->root = _##name##_heap_merge_pairs(root->child);  \
+  h->count--; \
+  return name##_heap_get_entry(root); \
+} \
+void name##_heap_decrease_key(struct name##_heap *h, type *e) { \
+  assert(h);  \
+  assert(e);  \
+  if (&e->field == h->root) \
+    return; \
+  _##name##_heap_cut(&e->field);  \
+  h->root = _##name##_heap_link(h->root, &e->field);  \
+} \
+void name##_heap_remove(struct name##_heap *h, type *e) { \
+  assert(h);  \
+  assert(e);  \
+  struct fcl_heap_link *sub;  \
+  if (&e->field == h->root) { \
+    name##_heap_pop_min(h); \
+    return; \
+  } \
+  _##name##_heap_cut(&e->field);  \
+  sub = _##name##_heap_merge_pairs(e->field.child); \
+  h->root = _##name##_heap_link(h->root, sub);  \
+  h->count--; \
+} \
+void name##_heap_meld(struct name##_heap *dst, struct name##_heap *src) { \
+  assert(dst);  \
+  assert(src);  \
+  dst->root = _##name##_heap_link(dst->root, src->root);  \
+  dst->count += src->count; \
+  name##_heap_init(src);  \
+}
+
+
+#endif  // _FCL_HEAP_H_
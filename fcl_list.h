@@ -22,6 +22,40 @@
    a doubly-linked list with a tail pointer in the head for O(1) head/tail
    insert/remove/access.
 
+   Every list kind also moves whole lists in O(1): concat moves all elements
+   of one list after the last element of another, splice moves them before
+   the first element, move_all moves them into an empty list, and split_at
+   moves every element after a given element into a new list.
+   FCL_LIST_FIFO_LEN_XXX and FCL_LIST_LIFO_LEN_XXX generate the same lists
+   with the number of elements kept in the head (head->len, name##_list_len).
+   With length tracking, split_at walks the elements it moves to count them.
+
+   Every list kind can be ordered by a comparison function that returns <0,
+   0, or >0 like the one of qsort.  name##_list_sort is a bottom-up merge
+   sort in O(n log n) that relinks the elements in place without allocating,
+   and name##_list_merge_sorted merges a sorted list into another sorted
+   list in O(n).  Both are stable: elements that compare equal keep their
+   order, and on a merge those of dst come before those of src.  Both fix up
+   the last pointer of FIFO and LIFO heads and the prev links of DL lists.
+
+   Walking a long list takes one dependent cache miss per element.  The
+   FCL_LIST_XXX_EACH_PREFETCH macros walk the list like FCL_LIST_XXX_EACH
+   with a second cursor dist elements ahead, and prefetch the link under
+   that cursor.  name##_list_for_each calls a function on every element,
+   looking FCL_LIST_PREFETCH_DISTANCE elements ahead, and
+   name##_list_for_each_prefetch takes the distance and the number of
+   container cache lines to prefetch along with the link.  The element
+   passed to the function may be removed from the list by the function.
+   The lookahead cursor is itself a pointer chase: it can only run ahead of
+   the walk while the function spends longer on an element than one cache
+   miss takes.  For a plain scan of a pointer-chased list, where every hop
+   is a miss and the per-element work is small, it does not help, and
+   example/fcl_list_prefetch_bench.c measures every distance within noise
+   of no prefetch.  It pays off when the function does real work per
+   element, and payload_lines helps when that work touches container cache
+   lines beyond the one holding the link.  Measure before raising
+   FCL_LIST_PREFETCH_DISTANCE.
+
    Advanced usage:
    Object reuse:
    A struct with embedded fcl_list_links may have both
@@ -32,6 +66,13 @@
    The FCL_LIST_XXX_DEFINE macros may be used multiple times for the same
    struct as long as the name is unique.  A struct with multiple embedded link
    structs can thus be on multiple lists at the same time.
+   Static functions:
+   FCL_LIST_XXX_DEFINE generates functions with external linkage, which must
+   be defined in exactly one translation unit and can only be inlined into
+   other translation units with LTO.  FCL_LIST_XXX_DEFINE_STATIC generates
+   the same functions as static inline instead, and replaces both the
+   DECLARE and DEFINE macros.  It may be used in a header included by every
+   translation unit, and the compiler can inline every call.
 */
 
 /* Inspirations:
@@ -57,124 +98,398 @@ struct fcl_list_links {
 };
 
 
-#define FCL_LIST_FIFO_EACH(h, i, tmp)                              \
-  for (i = (h)->first; (i) && (tmp = i->next, 1); i = (tmp))
+// the number of elements name##_list_for_each looks ahead
+#ifndef FCL_LIST_PREFETCH_DISTANCE
+#define FCL_LIST_PREFETCH_DISTANCE 4
+#endif
 
-// name = list prefix, eg events
-// type = container type, eg event
-// field_type = the list link(s) type, eg struct fcl_list_link
-// field = name of the field_type struct in the container, eg link
-#define FCL_LIST_FIFO_DECLARE(name, type, field_type, field) \
+// the number of container cache lines name##_list_for_each prefetches along
+// with the link, 0 to prefetch only the link
+#ifndef FCL_LIST_PREFETCH_PAYLOAD
+#define FCL_LIST_PREFETCH_PAYLOAD 0
+#endif
+
+// returns the link @dist elements after @l in the list @head, or @head
+static inline struct fcl_list_links *_fcl_list_dl_ahead(
+    struct fcl_list_links *head, struct fcl_list_links *l, size_t dist) {
+  for (; l != head && dist; dist--)
+    l = l->next;
+  return l;
+}
+
+// the number of sorted runs name##_list_sort keeps, enough for 2^63 elements
+#define FCL_LIST_SORT_BINS 64
+
+// prefetches @lines cache lines of the container of type @type around the
+// link @l which is the field @field of the container
+#define _FCL_LIST_PREFETCH_ENTRY(l, type, field, lines) \
+  do {  \
+    size_t _k;  \
+    FCL_PREFETCH(l);  \
+    for (_k = 0; _k < (lines); _k++)  \
+      FCL_PREFETCH(FCL_PTR_PAST(FCL_CONTAINER_OF(l, type, field), \
+                                _k * LEVEL1_DCACHE_LINESIZE));  \
+  } while (0)
+
+
+// length tracking hooks for the singly-linked lists, selected by len_mode
+#define _FCL_LIST_NOLEN_FIELD
+#define _FCL_LIST_NOLEN_SET(head, n)
+#define _FCL_LIST_NOLEN_ADD(head, n)
+#define _FCL_LIST_NOLEN_SUB(head, n)
+#define _FCL_LIST_NOLEN_DECLARE(scope, name)
+#define _FCL_LIST_NOLEN_DEFINE(scope, name)
+#define _FCL_LIST_LEN_FIELD size_t len;
+#define _FCL_LIST_LEN_SET(head, n) ((head)->len = (n))
+#define _FCL_LIST_LEN_ADD(head, n) ((head)->len += (n))
+#define _FCL_LIST_LEN_SUB(head, n) ((head)->len -= (n))
+#define _FCL_LIST_LEN_DECLARE(scope, name) \
+scope size_t name##_list_len(struct name##_list_head *head);
+#define _FCL_LIST_LEN_DEFINE(scope, name) \
+scope size_t name##_list_len(struct name##_list_head *head) {\
+  assert(head); \
+  return head->len; \
+}
+
+// the head of the FIFO and LIFO lists, both of which keep first and last
+// pointers
+#define _FCL_LIST_SL_HEAD(name, field_type, len_mode) \
 struct name##_list_head {\
   field_type *first; \
   field_type *last; \
-};  \
-void name##_list_head_init(struct name##_list_head *head);  \
-type *name##_list_get_entry(field_type *e); \
-int name##_list_is_empty(struct name##_list_head *head);  \
-void name##_list_insert(struct name##_list_head *head, type *e);  \
-type *name##_list_get(struct name##_list_head *head); \
-type *name##_list_remove(struct name##_list_head *head);
+  _FCL_LIST_##len_mode##_FIELD \
+};
+#define _FCL_LIST_FIFO_HEAD(name, field_type, len_mode) \
+  _FCL_LIST_SL_HEAD(name, field_type, len_mode)
+#define _FCL_LIST_LIFO_HEAD(name, field_type, len_mode) \
+  _FCL_LIST_SL_HEAD(name, field_type, len_mode)
 
+// functions shared by the FIFO and LIFO lists
+#define _FCL_LIST_SL_DECLARE(scope, name, type, field_type, field, len_mode) \
+scope void name##_list_head_init(struct name##_list_head *head);  \
+scope type *name##_list_get_entry(field_type *e); \
+scope int name##_list_is_empty(struct name##_list_head *head);  \
+scope void name##_list_insert(struct name##_list_head *head, type *e);  \
+scope type *name##_list_get(struct name##_list_head *head); \
+scope type *name##_list_remove(struct name##_list_head *head);  \
+scope void name##_list_concat(struct name##_list_head *dst, \
+                              struct name##_list_head *src);  \
+scope void name##_list_splice(struct name##_list_head *dst, \
+                              struct name##_list_head *src);  \
+scope void name##_list_move_all(struct name##_list_head *dst, \
+                                struct name##_list_head *src);  \
+scope void name##_list_split_at(struct name##_list_head *head, type *e, \
+                                struct name##_list_head *rest); \
+scope void name##_list_for_each(struct name##_list_head *head, \
+                                void (*fn)(type *e, void *ctx), void *ctx); \
+scope void name##_list_for_each_prefetch(struct name##_list_head *head, \
+                                         void (*fn)(type *e, void *ctx), \
+                                         void *ctx, size_t dist, \
+                                         size_t payload_lines); \
+scope field_type *_##name##_list_ahead(field_type *l, size_t dist); \
+scope field_type *_##name##_list_merge(field_type *a, field_type *b, \
+                                       int (*cmp)(type *a, type *b)); \
+scope void name##_list_sort(struct name##_list_head *head, \
+                            int (*cmp)(type *a, type *b)); \
+scope void name##_list_merge_sorted(struct name##_list_head *dst, \
+                                    struct name##_list_head *src, \
+                                    int (*cmp)(type *a, type *b)); \
+_FCL_LIST_##len_mode##_DECLARE(scope, name)
 
-#define FCL_LIST_FIFO_DEFINE(name, type, field_type, field) \
-void name##_list_head_init(struct name##_list_head *head) {\
+#define _FCL_LIST_SL_DEFINE(scope, name, type, field_type, field, len_mode) \
+scope void name##_list_head_init(struct name##_list_head *head) {\
   assert(head); \
   head->first = NULL; \
+  _FCL_LIST_##len_mode##_SET(head, 0);  \
 } \
-type *name##_list_get_entry(field_type *e) {\
+scope type *name##_list_get_entry(field_type *e) {\
   assert(e);  \
   return FCL_CONTAINER_OF(e, type, field);  \
 } \
-int name##_list_is_empty(struct name##_list_head *head) {\
+scope int name##_list_is_empty(struct name##_list_head *head) {\
   assert(head); \
   return head->first ? 0 : 1; \
 } \
-void name##_list_insert(struct name##_list_head *head, type *e) {\
-  assert(head); \
-  assert(e);  \
-  if (! name##_list_is_empty(head)) { \
-    head->last->next = &e->field;  \
-  } else {  \
-    head->first = &e->field;  \
-  } \
-  head->last = &e->field; \
-  e->field.next = NULL; \
-} \
-type *name##_list_get(struct name##_list_head *head) {\
+scope type *name##_list_get(struct name##_list_head *head) {\
   assert(head); \
   if (!name##_list_is_empty(head)) \
     return name##_list_get_entry(head->first); \
   return NULL;  \
 } \
-type *name##_list_remove(struct name##_list_head *head) {\
+scope type *name##_list_remove(struct name##_list_head *head) {\
   assert(head); \
   type *tmp;  \
   if (!name##_list_is_empty(head)) {  \
     tmp = name##_list_get_entry(head->first); \
     head->first = head->first->next;  \
+    _FCL_LIST_##len_mode##_SUB(head, 1);  \
     return tmp; \
   } \
   return NULL;  \
+} \
+scope void name##_list_concat(struct name##_list_head *dst, \
+                              struct name##_list_head *src) {\
+  assert(dst);  \
+  assert(src);  \
+  if (name##_list_is_empty(src)) \
+    return; \
+  if (! name##_list_is_empty(dst)) { \
+    dst->last->next = src->first; \
+  } else {  \
+    dst->first = src->first;  \
+  } \
+  dst->last = src->last;  \
+  src->first = NULL;  \
+  _FCL_LIST_##len_mode##_ADD(dst, src->len);  \
+  _FCL_LIST_##len_mode##_SET(src, 0); \
+} \
+scope void name##_list_splice(struct name##_list_head *dst, \
+                              struct name##_list_head *src) {\
+  assert(dst);  \
+  assert(src);  \
+  if (name##_list_is_empty(src)) \
+    return; \
+  if (! name##_list_is_empty(dst)) { \
+    src->last->next = dst->first; \
+  } else {  \
+    dst->last = src->last;  \
+  } \
+  dst->first = src->first;  \
+  src->first = NULL;  \
+  _FCL_LIST_##len_mode##_ADD(dst, src->len);  \
+  _FCL_LIST_##len_mode##_SET(src, 0); \
+} \
+scope void name##_list_move_all(struct name##_list_head *dst, \
+                                struct name##_list_head *src) {\
+  assert(dst);  \
+  assert(src);  \
+  assert(name##_list_is_empty(dst));  \
+  *dst = *src;  \
+  src->first = NULL;  \
+  _FCL_LIST_##len_mode##_SET(src, 0); \
+} \
+scope void name##_list_split_at(struct name##_list_head *head, type *e, \
+                                struct name##_list_head *rest) {\
+  assert(head); \
+  assert(e);  \
+  assert(rest); \
+  rest->first = e->field.next;  \
+  _FCL_LIST_##len_mode##_SET(rest, 0); \
+  if (!rest->first) \
+    return; \
+  rest->last = head->last;  \
+  head->last = &e->field; \
+  e->field.next = NULL; \
+  _FCL_LIST_##len_mode##_SPLIT(head, rest, field_type); \
+} \
+scope field_type *_##name##_list_ahead(field_type *l, size_t dist) {\
+  for (; l && dist; dist--) \
+    l = l->next;  \
+  return l; \
+} \
+scope void name##_list_for_each_prefetch(struct name##_list_head *head, \
+                                         void (*fn)(type *e, void *ctx), \
+                                         void *ctx, size_t dist, \
+                                         size_t payload_lines) {\
+  assert(head); \
+  assert(fn); \
+  field_type *i, *tmp, *ahead;  \
+  ahead = dist ? _##name##_list_ahead(head->first, dist - 1) : NULL; \
+  for (i = head->first; i; i = tmp) { \
+    tmp = i->next;  \
+    if (ahead && (ahead = ahead->next)) \
+      _FCL_LIST_PREFETCH_ENTRY(ahead, type, field, payload_lines); \
+    fn(name##_list_get_entry(i), ctx);  \
+  } \
+} \
+scope void name##_list_for_each(struct name##_list_head *head, \
+                                void (*fn)(type *e, void *ctx), void *ctx) {\
+  name##_list_for_each_prefetch(head, fn, ctx, FCL_LIST_PREFETCH_DISTANCE, \
+                                FCL_LIST_PREFETCH_PAYLOAD); \
+} \
+scope field_type *_##name##_list_merge(field_type *a, field_type *b, \
+                                       int (*cmp)(type *a, type *b)) {\
+  field_type *first = NULL, **tail = &first;  \
+  while (a && b) {  \
+    if (cmp(name##_list_get_entry(b), name##_list_get_entry(a)) < 0) { \
+      *tail = b;  \
+      b = b->next;  \
+    } else {  \
+      *tail = a;  \
+      a = a->next;  \
+    } \
+    tail = &(*tail)->next;  \
+  } \
+  *tail = a ? a : b;  \
+  return first; \
+} \
+scope void name##_list_sort(struct name##_list_head *head, \
+                            int (*cmp)(type *a, type *b)) {\
+  assert(head); \
+  assert(cmp);  \
+  field_type *bins[FCL_LIST_SORT_BINS] = { NULL }, *l, *next;  \
+  int k, max = 0; \
+  for (l = head->first; l; l = next) {  \
+    next = l->next; \
+    l->next = NULL; \
+    for (k = 0; k < FCL_LIST_SORT_BINS - 1 && bins[k]; k++) { \
+      l = _##name##_list_merge(bins[k], l, cmp); \
+      bins[k] = NULL; \
+    } \
+    bins[k] = _##name##_list_merge(bins[k], l, cmp);  \
+    if (k > max)  \
+      max = k;  \
+  } \
+  for (l = NULL, k = 0; k <= max; k++)  \
+    l = _##name##_list_merge(bins[k], l, cmp);  \
+  head->first = l;  \
+  for (; l && l->next; l = l->next) \
+    ; \
+  if (l)  \
+    head->last = l; \
+} \
+scope void name##_list_merge_sorted(struct name##_list_head *dst, \
+                                    struct name##_list_head *src, \
+                                    int (*cmp)(type *a, type *b)) {\
+  assert(dst);  \
+  assert(src);  \
+  assert(cmp);  \
+  if (name##_list_is_empty(src))  \
+    return; \
+  if (name##_list_is_empty(dst) || \
+      cmp(name##_list_get_entry(src->last), \
+          name##_list_get_entry(dst->last)) >= 0)  \
+    dst->last = src->last;  \
+  dst->first = _##name##_list_merge(dst->first, src->first, cmp);  \
+  src->first = NULL;  \
+  _FCL_LIST_##len_mode##_ADD(dst, src->len);  \
+  _FCL_LIST_##len_mode##_SET(src, 0); \
+} \
+_FCL_LIST_##len_mode##_DEFINE(scope, name)
+
+#define _FCL_LIST_NOLEN_SPLIT(head, rest, field_type)
+#define _FCL_LIST_LEN_SPLIT(head, rest, field_type) \
+  do {  \
+    field_type *_i; \
+    for (_i = (rest)->first; _i; _i = _i->next) \
+      (rest)->len++;  \
+    (head)->len -= (rest)->len; \
+  } while (0)
+
+
+#define FCL_LIST_FIFO_EACH(h, i, tmp)                              \
+  for (i = (h)->first; (i) && (tmp = i->next, 1); i = (tmp))
+
+// same as FCL_LIST_FIFO_EACH, prefetching the link @dist elements ahead
+// name = the list prefix the list functions were generated with
+// ahead = a link ptr used as the lookahead cursor
+#define FCL_LIST_FIFO_EACH_PREFETCH(name, h, i, tmp, ahead, dist)    \
+  for (i = (h)->first, ahead = _##name##_list_ahead(i, dist);      \
+       (i) && (tmp = i->next, 1);                                  \
+       i = (tmp), ahead = (ahead) ? (ahead)->next : NULL,          \
+       FCL_PREFETCH(ahead))
+
+// name = list prefix, eg events
+// type = container type, eg event
+// field_type = the list link(s) type, eg struct fcl_list_link
+// field = name of the field_type struct in the container, eg link
+#define FCL_LIST_FIFO_DECLARE(name, type, field_type, field) \
+  _FCL_LIST_FIFO_DECLARE(, name, type, field_type, field, NOLEN)
+
+#define FCL_LIST_FIFO_DEFINE(name, type, field_type, field) \
+  _FCL_LIST_FIFO_DEFINE(, name, type, field_type, field, NOLEN)
+
+// same as FCL_LIST_FIFO_XXX, with the number of elements kept in head->len
+#define FCL_LIST_FIFO_LEN_DECLARE(name, type, field_type, field) \
+  _FCL_LIST_FIFO_DECLARE(, name, type, field_type, field, LEN)
+
+#define FCL_LIST_FIFO_LEN_DEFINE(name, type, field_type, field) \
+  _FCL_LIST_FIFO_DEFINE(, name, type, field_type, field, LEN)
+
+// same as FCL_LIST_FIFO_XXX, with static inline functions (no DECLARE needed)
+#define FCL_LIST_FIFO_DEFINE_STATIC(name, type, field_type, field) \
+  _FCL_LIST_FIFO_DECLARE(static inline, name, type, field_type, field, NOLEN) \
+  _FCL_LIST_FIFO_DEFINE(static inline, name, type, field_type, field, NOLEN)
+
+#define FCL_LIST_FIFO_LEN_DEFINE_STATIC(name, type, field_type, field) \
+  _FCL_LIST_FIFO_DECLARE(static inline, name, type, field_type, field, LEN) \
+  _FCL_LIST_FIFO_DEFINE(static inline, name, type, field_type, field, LEN)
+
+#define _FCL_LIST_FIFO_DECLARE(scope, name, type, field_type, field, len_mode) \
+_FCL_LIST_FIFO_HEAD(name, field_type, len_mode) \
+_FCL_LIST_SL_DECLARE(scope, name, type, field_type, field, len_mode)
+
+#define _FCL_LIST_FIFO_DEFINE(scope, name, type, field_type, field, len_mode) \
+_FCL_LIST_SL_DEFINE(scope, name, type, field_type, field, len_mode) \
+scope void name##_list_insert(struct name##_list_head *head, type *e) {\
+  assert(head); \
+  assert(e);  \
+  if (! name##_list_is_empty(head)) { \
+    head->last->next = &e->field;  \
+  } else {  \
+    head->first = &e->field;  \
+  } \
+  head->last = &e->field; \
+  e->field.next = NULL; \
+  _FCL_LIST_##len_mode##_ADD(head, 1);  \
 }
 
 
 #define FCL_LIST_LIFO_EACH(h, i, tmp)                              \
   for (i = (h)->first; (i) && (tmp = i->next, 1); i = (tmp))
 
+// same as FCL_LIST_LIFO_EACH, prefetching the link @dist elements ahead
+// name = the list prefix the list functions were generated with
+// ahead = a link ptr used as the lookahead cursor
+#define FCL_LIST_LIFO_EACH_PREFETCH(name, h, i, tmp, ahead, dist)    \
+  for (i = (h)->first, ahead = _##name##_list_ahead(i, dist);      \
+       (i) && (tmp = i->next, 1);                                  \
+       i = (tmp), ahead = (ahead) ? (ahead)->next : NULL,          \
+       FCL_PREFETCH(ahead))
+
 // name = list prefix, eg events
 // type = container type, eg event
 // field_type = the list link(s) type, eg struct fcl_list_link
 // field = name of the field_type struct in the container, eg link
 #define FCL_LIST_LIFO_DECLARE(name, type, field_type, field) \
-struct name##_list_head {\
-  field_type *first; \
-};  \
-void name##_list_head_init(struct name##_list_head *head);  \
-type *name##_list_get_entry(field_type *e); \
-int name##_list_is_empty(struct name##_list_head *head);  \
-void name##_list_insert(struct name##_list_head *head, type *e);  \
-type *name##_list_get(struct name##_list_head *head); \
-type *name##_list_remove(struct name##_list_head *head);
+  _FCL_LIST_LIFO_DECLARE(, name, type, field_type, field, NOLEN)
 
 #define FCL_LIST_LIFO_DEFINE(name, type, field_type, field) \
-void name##_list_head_init(struct name##_list_head *head) {\
-  assert(head); \
-  head->first = NULL; \
-} \
-type *name##_list_get_entry(field_type *e) {\
-  assert(e);  \
-  return FCL_CONTAINER_OF(e, type, field);  \
-} \
-int name##_list_is_empty(struct name##_list_head *head) {\
-  assert(head); \
-  return head->first ? 0 : 1; \
-} \
-void name##_list_insert(struct name##_list_head *head, type *e) {\
+  _FCL_LIST_LIFO_DEFINE(, name, type, field_type, field, NOLEN)
+
+// same as FCL_LIST_LIFO_XXX, with the number of elements kept in head->len
+#define FCL_LIST_LIFO_LEN_DECLARE(name, type, field_type, field) \
+  _FCL_LIST_LIFO_DECLARE(, name, type, field_type, field, LEN)
+
+#define FCL_LIST_LIFO_LEN_DEFINE(name, type, field_type, field) \
+  _FCL_LIST_LIFO_DEFINE(, name, type, field_type, field, LEN)
+
+// same as FCL_LIST_LIFO_XXX, with static inline functions (no DECLARE needed)
+#define FCL_LIST_LIFO_DEFINE_STATIC(name, type, field_type, field) \
+  _FCL_LIST_LIFO_DECLARE(static inline, name, type, field_type, field, NOLEN) \
+  _FCL_LIST_LIFO_DEFINE(static inline, name, type, field_type, field, NOLEN)
+
+#define FCL_LIST_LIFO_LEN_DEFINE_STATIC(name, type, field_type, field) \
+  _FCL_LIST_LIFO_DECLARE(static inline, name, type, field_type, field, LEN) \
+  _FCL_LIST_LIFO_DEFINE(static inline, name, type, field_type, field, LEN)
+
+#define _FCL_LIST_LIFO_DECLARE(scope, name, type, field_type, field, len_mode) \
+_FCL_LIST_LIFO_HEAD(name, field_type, len_mode) \
+_FCL_LIST_SL_DECLARE(scope, name, type, field_type, field, len_mode)
+
+#define _FCL_LIST_LIFO_DEFINE(scope, name, type, field_type, field, len_mode) \
+_FCL_LIST_SL_DEFINE(scope, name, type, field_type, field, len_mode) \
+scope void name##_list_insert(struct name##_list_head *head, type *e) {\
   assert(head); \
   assert(e);  \
   if (! name##_list_is_empty(head)) { \
     e->field.next = head->first;  \
   } else {  \
     e->field.next = NULL;  \
+    head->last = &e->field; \
   } \
   head->first = &e->field; \
-} \
-type *name##_list_get(struct name##_list_head *head) {\
-  assert(head); \
-  if (!name##_list_is_empty(head)) \
-    return name##_list_get_entry(head->first); \
-  return NULL;  \
-} \
-type *name##_list_remove(struct name##_list_head *head) {\
-  assert(head); \
-  type *tmp;  \
-  if (!name##_list_is_empty(head)) {  \
-    tmp = name##_list_get_entry(head->first); \
-    head->first = head->first->next;  \
-    return tmp; \
-  } \
-  return NULL;  \
+  _FCL_LIST_##len_mode##_ADD(head, 1);  \
 }
 
 
@@ -190,22 +505,65 @@ static inline void fcl_list_dl_init(struct fcl_list_links *head) {
 #define FCL_LIST_DL_EACH(l, i, tmp)                              \
   for (i = (l)->next; (i != (l)) && (tmp = i->next); i = (tmp)) 
 
+// same as FCL_LIST_DL_EACH, prefetching the link @dist elements ahead
+// ahead = an fcl_list_links ptr used as the lookahead cursor
+#define FCL_LIST_DL_EACH_PREFETCH(l, i, tmp, ahead, dist)        \
+  for (i = (l)->next, ahead = _fcl_list_dl_ahead(l, i, dist);    \
+       (i != (l)) && (tmp = i->next);                            \
+       i = (tmp), ahead = (ahead != (l)) ? (ahead)->next : (ahead), \
+       FCL_PREFETCH(ahead))
+
 // name = list prefix, eg events
 // type = container type, eg event
 // field = name of the fcl_list_links struct in the container
 #define FCL_LIST_DL_DECLARE(name, type, field) \
-void name##_list_insert_head(struct fcl_list_links *head, type *e); \
-void name##_list_insert_tail(struct fcl_list_links *head, type *e); \
-void name##_list_insert_after(type *current, type *e);  \
-void name##_list_insert_before(type *current, type *e); \
-void name##_list_remove(type *e); \
-type *name##_list_get_entry(struct fcl_list_links *e);  \
-type *name##_list_get_first(struct fcl_list_links *head); \
-type *name##_list_get_last(struct fcl_list_links *head);  \
-int name##_list_is_empty(struct fcl_list_links *head);
+  _FCL_LIST_DL_DECLARE(, name, type, field)
 
 #define FCL_LIST_DL_DEFINE(name, type, field) \
-void name##_list_insert_head(struct fcl_list_links *head, type *e) {\
+  _FCL_LIST_DL_DEFINE(, name, type, field)
+
+// same as FCL_LIST_DL_XXX, with static inline functions (no DECLARE needed)
+#define FCL_LIST_DL_DEFINE_STATIC(name, type, field) \
+  _FCL_LIST_DL_DECLARE(static inline, name, type, field) \
+  _FCL_LIST_DL_DEFINE(static inline, name, type, field)
+
+#define _FCL_LIST_DL_DECLARE(scope, name, type, field) \
+scope void name##_list_insert_head(struct fcl_list_links *head, type *e); \
+scope void name##_list_insert_tail(struct fcl_list_links *head, type *e); \
+scope void name##_list_insert_after(type *current, type *e);  \
+scope void name##_list_insert_before(type *current, type *e); \
+scope void name##_list_remove(type *e); \
+scope type *name##_list_get_entry(struct fcl_list_links *e);  \
+scope type *name##_list_get_first(struct fcl_list_links *head); \
+scope type *name##_list_get_last(struct fcl_list_links *head);  \
+scope int name##_list_is_empty(struct fcl_list_links *head);  \
+scope void name##_list_concat(struct fcl_list_links *dst, \
+                              struct fcl_list_links *src);  \
+scope void name##_list_splice(struct fcl_list_links *dst, \
+                              struct fcl_list_links *src);  \
+scope void name##_list_move_all(struct fcl_list_links *dst, \
+                                struct fcl_list_links *src);  \
+scope void name##_list_split_at(struct fcl_list_links *head, type *e, \
+                                struct fcl_list_links *rest); \
+scope void name##_list_for_each(struct fcl_list_links *head, \
+                                void (*fn)(type *e, void *ctx), void *ctx); \
+scope void name##_list_for_each_prefetch(struct fcl_list_links *head, \
+                                         void (*fn)(type *e, void *ctx), \
+                                         void *ctx, size_t dist, \
+                                         size_t payload_lines); \
+scope struct fcl_list_links *_##name##_list_merge( \
+    struct fcl_list_links *a, struct fcl_list_links *b, \
+    int (*cmp)(type *a, type *b)); \
+scope void _##name##_list_relink(struct fcl_list_links *head, \
+                                 struct fcl_list_links *first); \
+scope void name##_list_sort(struct fcl_list_links *head, \
+                            int (*cmp)(type *a, type *b)); \
+scope void name##_list_merge_sorted(struct fcl_list_links *dst, \
+                                    struct fcl_list_links *src, \
+                                    int (*cmp)(type *a, type *b));
+
+#define _FCL_LIST_DL_DEFINE(scope, name, type, field) \
+scope void name##_list_insert_head(struct fcl_list_links *head, type *e) {\
   assert(head); \
   assert(e);  \
   e->field.prev = head; \
@@ -213,7 +571,7 @@ void name##_list_insert_head(struct fcl_list_links *head, type *e) {\
   head->next->prev = &e->field; \
   head->next = &e->field; \
 } \
-void name##_list_insert_tail(struct fcl_list_links *head, type *e) {\
+scope void name##_list_insert_tail(struct fcl_list_links *head, type *e) {\
   assert(head); \
   assert(e);  \
   e->field.prev = head->prev;  \
@@ -221,7 +579,7 @@ void name##_list_insert_tail(struct fcl_list_links *head, type *e) {\
   head->prev->next = &e->field; \
   head->prev = &e->field; \
 } \
-void name##_list_insert_after(type *current, type *e) {\
+scope void name##_list_insert_after(type *current, type *e) {\
   assert(current);  \
   assert(e);  \
   e->field.prev = &current->field;  \
@@ -229,7 +587,7 @@ void name##_list_insert_after(type *current, type *e) {\
   current->field.next->prev = &e->field;  \
   current->field.next = &e->field;  \
 } \
-void name##_list_insert_before(type *current, type *e) {\
+scope void name##_list_insert_before(type *current, type *e) {\
   assert(current);  \
   assert(e);  \
   e->field.prev = current->field.prev;  \
@@ -237,30 +595,162 @@ void name##_list_insert_before(type *current, type *e) {\
   current->field.prev->next = &e->field;  \
   current->field.prev = &e->field;  \
 } \
-void name##_list_remove(type *e) {\
+scope void name##_list_remove(type *e) {\
   assert(e);  \
   e->field.prev->next = e->field.next;  \
   e->field.next->prev = e->field.prev;  \
 } \
-type *name##_list_get_entry(struct fcl_list_links *e) {\
+scope type *name##_list_get_entry(struct fcl_list_links *e) {\
   assert(e);  \
   return FCL_CONTAINER_OF(e, type, field);  \
 } \
-type *name##_list_get_first(struct fcl_list_links *head) {\
+scope type *name##_list_get_first(struct fcl_list_links *head) {\
   assert(head); \
   if (head->next == head) \
     return NULL;  \
   return name##_list_get_entry(head->next); \
 } \
-type *name##_list_get_last(struct fcl_list_links *head) {\
+scope type *name##_list_get_last(struct fcl_list_links *head) {\
   assert(head); \
   if (head->prev == head) \
     return NULL;  \
   return name##_list_get_entry(head->prev); \
 } \
-int name##_list_is_empty(struct fcl_list_links *head) {\
+scope int name##_list_is_empty(struct fcl_list_links *head) {\
   assert(head); \
   return head->next == head;  \
+} \
+scope void name##_list_concat(struct fcl_list_links *dst, \
+                              struct fcl_list_links *src) {\
+  assert(dst);  \
+  assert(src);  \
+  if (name##_list_is_empty(src)) \
+    return; \
+  src->next->prev = dst->prev;  \
+  src->prev->next = dst;  \
+  dst->prev->next = src->next;  \
+  dst->prev = src->prev;  \
+  fcl_list_dl_init(src);  \
+} \
+scope void name##_list_splice(struct fcl_list_links *dst, \
+                              struct fcl_list_links *src) {\
+  assert(dst);  \
+  assert(src);  \
+  if (name##_list_is_empty(src)) \
+    return; \
+  src->prev->next = dst->next;  \
+  src->next->prev = dst;  \
+  dst->next->prev = src->prev;  \
+  dst->next = src->next;  \
+  fcl_list_dl_init(src);  \
+} \
+scope void name##_list_move_all(struct fcl_list_links *dst, \
+                                struct fcl_list_links *src) {\
+  assert(dst);  \
+  assert(src);  \
+  assert(name##_list_is_empty(dst));  \
+  name##_list_concat(dst, src); \
+} \
+scope void name##_list_split_at(struct fcl_list_links *head, type *e, \
+                                struct fcl_list_links *rest) {\
+  assert(head); \
+  assert(e);  \
+  assert(rest); \
+  fcl_list_dl_init(rest); \
+  if (e->field.next == head) \
+    return; \
+  rest->next = e->field.next; \
+  rest->prev = head->prev;  \
+  rest->next->prev = rest;  \
+  rest->prev->next = rest;  \
+  e->field.next = head; \
+  head->prev = &e->field; \
+} \
+scope void name##_list_for_each_prefetch(struct fcl_list_links *head, \
+                                         void (*fn)(type *e, void *ctx), \
+                                         void *ctx, size_t dist, \
+                                         size_t payload_lines) {\
+  assert(head); \
+  assert(fn); \
+  struct fcl_list_links *i, *tmp, *ahead; \
+  ahead = dist ? _fcl_list_dl_ahead(head, head->next, dist - 1) : head; \
+  for (i = head->next; i != head; i = tmp) { \
+    tmp = i->next;  \
+    if (ahead != head && (ahead = ahead->next) != head) \
+      _FCL_LIST_PREFETCH_ENTRY(ahead, type, field, payload_lines); \
+    fn(name##_list_get_entry(i), ctx);  \
+  } \
+} \
+scope void name##_list_for_each(struct fcl_list_links *head, \
+                                void (*fn)(type *e, void *ctx), void *ctx) {\
+  name##_list_for_each_prefetch(head, fn, ctx, FCL_LIST_PREFETCH_DISTANCE, \
+                                FCL_LIST_PREFETCH_PAYLOAD); \
+} \
+scope struct fcl_list_links *_##name##_list_merge( \
+    struct fcl_list_links *a, struct fcl_list_links *b, \
+    int (*cmp)(type *a, type *b)) {\
+  struct fcl_list_links *first = NULL, **tail = &first; \
+  while (a && b) {  \
+    if (cmp(name##_list_get_entry(b), name##_list_get_entry(a)) < 0) { \
+      *tail = b;  \
+      b = b->next;  \
+    } else {  \
+      *tail = a;  \
+      a = a->next;  \
+    } \
+    tail = &(*tail)->next;  \
+  } \
+  *tail = a ? a : b;  \
+  return first; \
+} \
+scope void _##name##_list_relink(struct fcl_list_links *head, \
+                                 struct fcl_list_links *first) {\
+  struct fcl_list_links *prev = head; \
+  head->next = first; \
+  for (; first; prev = first, first = first->next)  \
+    first->prev = prev; \
+  prev->next = head;  \
+  head->prev = prev;  \
+} \
+scope void name##_list_sort(struct fcl_list_links *head, \
+                            int (*cmp)(type *a, type *b)) {\
+  assert(head); \
+  assert(cmp);  \
+  struct fcl_list_links *bins[FCL_LIST_SORT_BINS] = { NULL }, *l, *next;  \
+  int k, max = 0; \
+  head->prev->next = NULL;  \
+  for (l = head->next; l && l != head; l = next) {  \
+    next = l->next; \
+    l->next = NULL; \
+    for (k = 0; k < FCL_LIST_SORT_BINS - 1 && bins[k]; k++) { \
+      l = _##name##_list_merge(bins[k], l, cmp); \
+      bins[k] = NULL; \
+    } \
+    bins[k] = _##name##_list_merge(bins[k], l, cmp);  \
+    if (k > max)  \
+      max = k;  \
+  } \
+  for (l = NULL, k = 0; k <= max; k++)  \
+    l = _##name##_list_merge(bins[k], l, cmp);  \
+  _##name##_list_relink(head, l); \
+} \
+scope void name##_list_merge_sorted(struct fcl_list_links *dst, \
+                                    struct fcl_list_links *src, \
+                                    int (*cmp)(type *a, type *b)) {\
+  assert(dst);  \
+  assert(src);  \
+  assert(cmp);  \
+  struct fcl_list_links *a = NULL, *b;  \
+  if (name##_list_is_empty(src))  \
+    return; \
+  if (!name##_list_is_empty(dst)) { \
+    dst->prev->next = NULL; \
+    a = dst->next;  \
+  } \
+  src->prev->next = NULL; \
+  b = src->next;  \
+  _##name##_list_relink(dst, _##name##_list_merge(a, b, cmp));  \
+  fcl_list_dl_init(src);  \
 }
 
 
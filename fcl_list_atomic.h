@@ -0,0 +1,278 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only library of lock-free linked lists.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Allocation and deallocation are not managed by this library and are the
+   responsibility of the caller.
+   Requires C11 atomics.  Lists with a tagged head need a double-width
+   compare-and-swap; on x86-64 link with -latomic (which uses cmpxchg16b).
+
+   The fcl_list_link struct, together with FCL_LIST_LIFO_ATOMIC_XXX macros
+   implement a lock-free singly-linked list (a Treiber stack) where items are
+   inserted at the head and removed from the head by any number of threads.
+   The head pairs the first pointer with a tag that is incremented by every
+   successful update, so a pop that raced with a pop and re-push of the same
+   node (the ABA problem) fails its compare-and-swap instead of corrupting the
+   list.  Insert (push) and remove (pop) are lock-free.  Splice detaches
+   the whole source list and pushes it on top of the destination, which
+   walks the source once to find its tail.
+   The generated functions have the same names and signatures as the
+   FCL_LIST_LIFO_XXX functions, so LIFO_ATOMIC may be used as the recycle
+   policy of FCL_ALLOCATOR_LL.  Only the free list then tolerates concurrent
+   access; the allocator counters are still owned by a single thread.
+
+   The fcl_list_link struct, together with FCL_LIST_MPSC_XXX macros implement
+   an intrusive multi-producer single-consumer queue (Vyukov's algorithm).
+   Any number of threads may push at the tail; push is wait-free (one atomic
+   exchange).  Only one thread at a time may pop or drain at the head.  A pop
+   that observes a producer between its exchange and its link store reports
+   the queue as empty; the element becomes visible once the producer
+   finishes.  The head embeds a stub link, so it must not be copied or moved
+   after init.
+
+   Nodes removed from a lock-free list may still be read by a thread that is
+   about to fail its compare-and-swap.  Their memory must therefore stay
+   mapped while any thread may be using the list, which is the case for
+   objects owned by FCL_ALLOCATOR_LL.
+*/
+
+#ifndef _FCL_LIST_ATOMIC_H_
+#define _FCL_LIST_ATOMIC_H_
+
+#include <assert.h>     // assert
+#include <stddef.h>     // offsetof
+#include <stdint.h>     // uintptr_t
+#include <stdatomic.h>  // atomic_compare_exchange_weak_explicit
+#include "fcl_list.h"
+#include "fcl_macro.h"
+
+// views the next pointer of the link @l of type @field_type as an atomic
+#define _FCL_LIST_ATOMIC_NEXT(field_type, l) \
+  ((_Atomic(field_type *) *)&(l)->next)
+
+
+// NOTE: this is only safe while no other thread modifies the list
+#define FCL_LIST_LIFO_ATOMIC_EACH(h, i, tmp)                       \
+  for (i = atomic_load(&(h)->top).first; (i) && (tmp = i->next, 1); i = (tmp))
+
+// name = list prefix, eg events
+// type = container type, eg event
+// field_type = the list link(s) type, eg struct fcl_list_link
+// field = name of the field_type struct in the container, eg link
+#define FCL_LIST_LIFO_ATOMIC_DECLARE(name, type, field_type, field) \
+  _FCL_LIST_LIFO_ATOMIC_DECLARE(, name, type, field_type, field, NOLEN)
+
+#define FCL_LIST_LIFO_ATOMIC_DEFINE(name, type, field_type, field) \
+  _FCL_LIST_LIFO_ATOMIC_DEFINE(, name, type, field_type, field, NOLEN)
+
+// same as FCL_LIST_LIFO_ATOMIC_XXX, with static inline functions
+#define FCL_LIST_LIFO_ATOMIC_DEFINE_STATIC(name, type, field_type, field) \
+  _FCL_LIST_LIFO_ATOMIC_DECLARE(static inline, name, type, field_type, \
+                                field, NOLEN) \
+  _FCL_LIST_LIFO_ATOMIC_DEFINE(static inline, name, type, field_type, \
+                               field, NOLEN)
+
+// len_mode must be NOLEN, it only matches the FCL_LIST_LIFO_XXX internals
+#define _FCL_LIST_LIFO_ATOMIC_DECLARE(scope, name, type, field_type, field, \
+                                      len_mode) \
+struct name##_list_top {\
+  field_type *first; \
+  uintptr_t tag; \
+};  \
+struct name##_list_head {\
+  _Atomic(struct name##_list_top) top; \
+};  \
+scope void name##_list_head_init(struct name##_list_head *head);  \
+scope type *name##_list_get_entry(field_type *e); \
+scope int name##_list_is_empty(struct name##_list_head *head);  \
+scope void name##_list_insert(struct name##_list_head *head, type *e);  \
+scope type *name##_list_get(struct name##_list_head *head); \
+scope type *name##_list_remove(struct name##_list_head *head);  \
+scope field_type *name##_list_remove_all(struct name##_list_head *head); \
+scope void name##_list_splice(struct name##_list_head *dst, \
+                              struct name##_list_head *src);
+
+#define _FCL_LIST_LIFO_ATOMIC_DEFINE(scope, name, type, field_type, field, \
+                                     len_mode) \
+scope void name##_list_head_init(struct name##_list_head *head) {\
+  assert(head); \
+  struct name##_list_top top = { NULL, 0 }; \
+  atomic_init(&head->top, top);  \
+} \
+scope type *name##_list_get_entry(field_type *e) {\
+  assert(e);  \
+  return FCL_CONTAINER_OF(e, type, field);  \
+} \
+scope int name##_list_is_empty(struct name##_list_head *head) {\
+  assert(head); \
+  return atomic_load(&head->top).first ? 0 : 1; \
+} \
+scope void name##_list_insert(struct name##_list_head *head, type *e) {\
+  assert(head); \
+  assert(e);  \
+  struct name##_list_top top, new_top; \
+  top = atomic_load_explicit(&head->top, memory_order_relaxed); \
+  new_top.first = &e->field; \
+  do {  \
+    atomic_store_explicit(_FCL_LIST_ATOMIC_NEXT(field_type, &e->field), \
+                          top.first, memory_order_relaxed); \
+    new_top.tag = top.tag + 1;  \
+  } while (!atomic_compare_exchange_weak_explicit(&head->top, &top, new_top, \
+                                                  memory_order_release, \
+                                                  memory_order_relaxed)); \
+} \
+scope type *name##_list_get(struct name##_list_head *head) {\
+  assert(head); \
+  field_type *first = atomic_load(&head->top).first; \
+  if (first) \
+    return name##_list_get_entry(first); \
+  return NULL;  \
+} \
+scope type *name##_list_remove(struct name##_list_head *head) {\
+  assert(head); \
+  struct name##_list_top top, new_top; \
+  top = atomic_load_explicit(&head->top, memory_order_acquire); \
+  do {  \
+    if (!top.first) \
+      return NULL;  \
+    new_top.first = atomic_load_explicit( \
+        _FCL_LIST_ATOMIC_NEXT(field_type, top.first), memory_order_relaxed); \
+    new_top.tag = top.tag + 1;  \
+  } while (!atomic_compare_exchange_weak_explicit(&head->top, &top, new_top, \
+                                                  memory_order_acquire, \
+                                                  memory_order_acquire)); \
+  return name##_list_get_entry(top.first); \
+} \
+scope field_type *name##_list_remove_all(struct name##_list_head *head) {\
+  assert(head); \
+  struct name##_list_top top, new_top; \
+  top = atomic_load_explicit(&head->top, memory_order_acquire); \
+  new_top.first = NULL; \
+  do {  \
+    new_top.tag = top.tag + 1;  \
+  } while (!atomic_compare_exchange_weak_explicit(&head->top, &top, new_top, \
+                                                  memory_order_acquire, \
+                                                  memory_order_acquire)); \
+  return top.first; \
+} \
+scope void name##_list_splice(struct name##_list_head *dst, \
+                              struct name##_list_head *src) {\
+  assert(dst);  \
+  assert(src);  \
+  struct name##_list_top top, new_top; \
+  field_type *last; \
+  new_top.first = name##_list_remove_all(src);  \
+  if (!new_top.first) \
+    return; \
+  for (last = new_top.first; last->next; last = last->next) \
+    ; \
+  top = atomic_load_explicit(&dst->top, memory_order_relaxed); \
+  do {  \
+    atomic_store_explicit(_FCL_LIST_ATOMIC_NEXT(field_type, last), \
+                          top.first, memory_order_relaxed); \
+    new_top.tag = top.tag + 1;  \
+  } while (!atomic_compare_exchange_weak_explicit(&dst->top, &top, new_top, \
+                                                  memory_order_release, \
+                                                  memory_order_relaxed)); \
+}
+
+
+// name = queue prefix, eg events
+// type = container type, eg event
+// field_type = the list link(s) type, eg struct fcl_list_link
+// field = name of the field_type struct in the container, eg link
+#define FCL_LIST_MPSC_DECLARE(name, type, field_type, field) \
+  _FCL_LIST_MPSC_DECLARE(, name, type, field_type, field)
+
+#define FCL_LIST_MPSC_DEFINE(name, type, field_type, field) \
+  _FCL_LIST_MPSC_DEFINE(, name, type, field_type, field)
+
+// same as FCL_LIST_MPSC_XXX, with static inline functions
+#define FCL_LIST_MPSC_DEFINE_STATIC(name, type, field_type, field) \
+  _FCL_LIST_MPSC_DECLARE(static inline, name, type, field_type, field) \
+  _FCL_LIST_MPSC_DEFINE(static inline, name, type, field_type, field)
+
+#define _FCL_LIST_MPSC_DECLARE(scope, name, type, field_type, field) \
+struct name##_mpsc_head {\
+  _Alignas(LEVEL1_DCACHE_LINESIZE) _Atomic(field_type *) last; \
+  _Alignas(LEVEL1_DCACHE_LINESIZE) field_type *first; \
+  field_type stub; \
+};  \
+scope void name##_mpsc_head_init(struct name##_mpsc_head *head);  \
+scope type *name##_mpsc_get_entry(field_type *e); \
+scope void _##name##_mpsc_push_link(struct name##_mpsc_head *head, \
+                                    field_type *l); \
+scope void name##_mpsc_push(struct name##_mpsc_head *head, type *e);  \
+scope type *name##_mpsc_pop(struct name##_mpsc_head *head); \
+scope size_t name##_mpsc_drain(struct name##_mpsc_head *head, type **out, \
+                               size_t max);
+
+#define _FCL_LIST_MPSC_DEFINE(scope, name, type, field_type, field) \
+scope void name##_mpsc_head_init(struct name##_mpsc_head *head) {\
+  assert(head); \
+  atomic_init(_FCL_LIST_ATOMIC_NEXT(field_type, &head->stub), NULL); \
+  atomic_init(&head->last, &head->stub); \
+  head->first = &head->stub; \
+} \
+scope type *name##_mpsc_get_entry(field_type *e) {\
+  assert(e);  \
+  return FCL_CONTAINER_OF(e, type, field);  \
+} \
+scope void _##name##_mpsc_push_link(struct name##_mpsc_head *head, \
+                                    field_type *l) {\
+  field_type *prev; \
+  atomic_store_explicit(_FCL_LIST_ATOMIC_NEXT(field_type, l), NULL, \
+                        memory_order_relaxed); \
+  prev = atomic_exchange_explicit(&head->last, l, memory_order_acq_rel); \
+  atomic_store_explicit(_FCL_LIST_ATOMIC_NEXT(field_type, prev), l, \
+                        memory_order_release); \
+} \
+scope void name##_mpsc_push(struct name##_mpsc_head *head, type *e) {\
+  assert(head); \
+  assert(e);  \
+  _##name##_mpsc_push_link(head, &e->field); \
+} \
+scope type *name##_mpsc_pop(struct name##_mpsc_head *head) {\
+  assert(head); \
+  field_type *first = head->first; \
+  field_type *next = atomic_load_explicit( \
+      _FCL_LIST_ATOMIC_NEXT(field_type, first), memory_order_acquire); \
+  if (first == &head->stub) { \
+    if (!next) \
+      return NULL;  \
+    head->first = next; \
+    first = next; \
+    next = atomic_load_explicit(_FCL_LIST_ATOMIC_NEXT(field_type, first), \
+                                memory_order_acquire); \
+  } \
+  if (next) { \
+    head->first = next; \
+    return name##_mpsc_get_entry(first); \
+  } \
+  if (first != atomic_load_explicit(&head->last, memory_order_acquire)) \
+    return NULL;  \
+  _##name##_mpsc_push_link(head, &head->stub); \
+  next = atomic_load_explicit(_FCL_LIST_ATOMIC_NEXT(field_type, first), \
+                              memory_order_acquire); \
+  if (next) { \
+    head->first = next; \
+    return name##_mpsc_get_entry(first); \
+  } \
+  return NULL;  \
+} \
+scope size_t name##_mpsc_drain(struct name##_mpsc_head *head, type **out, \
+                               size_t max) {\
+  assert(head); \
+  assert(out);  \
+  size_t n; \
+  for (n=0; n < max && (out[n] = name##_mpsc_pop(head)); n++) \
+    ; \
+  return n; \
+}
+
+
+#endif  // _FCL_LIST_ATOMIC_H_
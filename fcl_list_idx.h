@@ -0,0 +1,504 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only linked list library with 32-bit index links.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Allocation and deallocation are not managed by this library and are the
+   responsibility of the caller.
+   This library is NOT thread safe.
+
+   The lists of fcl_list.h link elements through pointers, so a doubly linked
+   element carries 16 bytes of links on a 64-bit system.  When every element
+   of a list lives in one array, eg a pool from an FCL_ALLOCATOR_LL created
+   with its full size and the ERROR oom policy (so it never grows past its
+   single slab), an element can instead be named by its position in the
+   array.  The fcl_list_idx_link(s) structs hold 32-bit indices, so a doubly
+   linked element carries 8 bytes of links and more elements fit in each
+   cache line.
+
+   Each list head stores the base of the array.  Index 0 is the NIL index,
+   and index i names base[i - 1], so zeroed links are unlinked.  At most
+   UINT32_MAX - 1 elements can be addressed.  Converting between an index and
+   an element is one multiply (usually a shift) and add; the caller still
+   works with element pointers throughout.
+
+   FCL_LIST_IDX_FIFO_XXX, FCL_LIST_IDX_LIFO_XXX and FCL_LIST_IDX_DL_XXX
+   generate the same functions as their fcl_list.h counterparts, including
+   concat, splice, move_all, split_at, sort and merge_sorted, except that
+   every function takes the list head, since an index means nothing without
+   the base, and both heads of a two list operation must share it.  Doubly
+   linked lists are NIL terminated instead of circular.
+
+   The allocator keeps its own free list while an element is not borrowed,
+   so its free list link and the index links may share storage in a union:
+     struct obj {
+       union { struct fcl_list_link flink; struct fcl_list_idx_links links; };
+     };
+   with flink given to FCL_ALLOCATOR_LL and links to FCL_LIST_IDX_XXX.
+   The pool base is FCL_LIST_IDX_POOL_BASE(&allocator, type).
+
+   THE POOL MUST BE A SINGLE SLAB.  An index is an offset from one base, and
+   the slabs of an allocator are separate allocations, so an element of any
+   slab but the first has no index.  Create the allocator with its full size
+   and the ERROR oom policy, so it never grows; FCL_LIST_IDX_POOL_BASE
+   returns NULL for any other allocator, in release builds too, and the
+   caller must check it.  Trimming the allocator would release the array and
+   must not be done while lists of it exist.
+*/
+
+#ifndef _FCL_LIST_IDX_H_
+#define _FCL_LIST_IDX_H_
+
+#include <assert.h>   // assert
+#include <stddef.h>   // offsetof
+#include <stdint.h>   // uint32_t
+#include "fcl_list.h"  // FCL_LIST_SORT_BINS
+
+
+typedef uint32_t fcl_list_idx;
+
+#define FCL_LIST_IDX_NIL ((fcl_list_idx)0)
+
+struct fcl_list_idx_link {
+  fcl_list_idx next;
+};
+
+struct fcl_list_idx_links {
+  fcl_list_idx next;
+  fcl_list_idx prev;
+};
+
+// returns the base of the single slab of an allocator that cannot grow, or
+// NULL if it has more than one slab or an oom policy other than ERROR
+// a = ptr to an initialized FCL_ALLOCATOR_LL allocator
+// type = the allocator's container type
+#define FCL_LIST_IDX_POOL_BASE(a, type) \
+  ((a)->num_slabs == 1 && \
+   (a)->oom_policy == FCL_ALLOCATOR_OOM_POLICY_ERROR ? \
+   (type*)(a)->allocations[0].mem : (type*)NULL)
+
+// NOTE: it is safe to remove elements while iterating with these macros
+// name = list prefix
+// h = ptr to an initialized name##_list_head
+// i, tmp = container ptrs
+#define FCL_LIST_IDX_FIFO_EACH(name, h, i, tmp)                        \
+  for (i = name##_list_get(h);                                         \
+       (i) && (tmp = name##_list_get_next(h, i), 1); i = (tmp))
+
+#define FCL_LIST_IDX_LIFO_EACH(name, h, i, tmp)                        \
+  for (i = name##_list_get(h);                                         \
+       (i) && (tmp = name##_list_get_next(h, i), 1); i = (tmp))
+
+#define FCL_LIST_IDX_DL_EACH(name, h, i, tmp)                          \
+  for (i = name##_list_get_first(h);                                   \
+       (i) && (tmp = name##_list_get_next(h, i), 1); i = (tmp))
+
+
+// functions shared by every index list, whose head has base, first and last
+#define _FCL_LIST_IDX_DECLARE(name, type) \
+void name##_list_head_init(struct name##_list_head *head, type *base);  \
+type *name##_list_get_entry(struct name##_list_head *head, fcl_list_idx i); \
+fcl_list_idx name##_list_get_index(struct name##_list_head *head, \
+                                   const type *e);  \
+int name##_list_is_empty(struct name##_list_head *head);  \
+type *name##_list_get_next(struct name##_list_head *head, type *e); \
+void name##_list_for_each(struct name##_list_head *head, \
+                          void (*fn)(type *e, void *ctx), void *ctx); \
+void name##_list_move_all(struct name##_list_head *dst, \
+                          struct name##_list_head *src);  \
+void _##name##_list_relink(struct name##_list_head *head, \
+                           fcl_list_idx first); \
+fcl_list_idx _##name##_list_merge(struct name##_list_head *head, \
+                                  fcl_list_idx a, fcl_list_idx b, \
+                                  int (*cmp)(type *a, type *b)); \
+void name##_list_sort(struct name##_list_head *head, \
+                      int (*cmp)(type *a, type *b));  \
+void name##_list_merge_sorted(struct name##_list_head *dst, \
+                              struct name##_list_head *src, \
+                              int (*cmp)(type *a, type *b));
+
+#define _FCL_LIST_IDX_DEFINE(name, type, field) \
+void name##_list_head_init(struct name##_list_head *head, type *base) { \
+  assert(head); \
+  assert(base); \
+  head->base = base;  \
+  head->first = FCL_LIST_IDX_NIL; \
+  head->last = FCL_LIST_IDX_NIL;  \
+} \
+type *name##_list_get_entry(struct name##_list_head *head, fcl_list_idx i) { \
+  assert(head); \
+  if (i == FCL_LIST_IDX_NIL)  \
+    return NULL;  \
+  return head->base + (i - 1);  \
+} \
+fcl_list_idx name##_list_get_index(struct name##_list_head *head, \
+                                   const type *e) { \
+  assert(head); \
+  assert(e);  \
+  assert(e >= head->base);  \
+  assert((size_t)(e - head->base) < UINT32_MAX - 1);  \
+  return (fcl_list_idx)(e - head->base) + 1;  \
+} \
+int name##_list_is_empty(struct name##_list_head *head) { \
+  assert(head); \
+  return head->first == FCL_LIST_IDX_NIL ? 1 : 0; \
+} \
+type *name##_list_get_next(struct name##_list_head *head, type *e) { \
+  assert(head); \
+  assert(e);  \
+  return name##_list_get_entry(head, e->field.next);  \
+} \
+void name##_list_for_each(struct name##_list_head *head, \
+                          void (*fn)(type *e, void *ctx), void *ctx) { \
+  assert(head); \
+  assert(fn); \
+  fcl_list_idx i, next; \
+  for (i = head->first; i != FCL_LIST_IDX_NIL; i = next) {  \
+    next = head->base[i - 1].field.next;  \
+    fn(head->base + (i - 1), ctx);  \
+  } \
+} \
+void name##_list_move_all(struct name##_list_head *dst, \
+                          struct name##_list_head *src) { \
+  assert(dst);  \
+  assert(src);  \
+  assert(dst->base == src->base); \
+  assert(name##_list_is_empty(dst));  \
+  dst->first = src->first;  \
+  dst->last = src->last;  \
+  src->first = src->last = FCL_LIST_IDX_NIL;  \
+} \
+fcl_list_idx _##name##_list_merge(struct name##_list_head *head, \
+                                  fcl_list_idx a, fcl_list_idx b, \
+                                  int (*cmp)(type *a, type *b)) { \
+  fcl_list_idx first = FCL_LIST_IDX_NIL, *tail = &first; \
+  while (a != FCL_LIST_IDX_NIL && b != FCL_LIST_IDX_NIL) {  \
+    if (cmp(head->base + (b - 1), head->base + (a - 1)) < 0) {  \
+      *tail = b;  \
+      b = head->base[b - 1].field.next; \
+    } else {  \
+      *tail = a;  \
+      a = head->base[a - 1].field.next; \
+    } \
+    tail = &head->base[*tail - 1].field.next; \
+  } \
+  *tail = a != FCL_LIST_IDX_NIL ? a : b;  \
+  return first; \
+} \
+void name##_list_sort(struct name##_list_head *head, \
+                      int (*cmp)(type *a, type *b)) { \
+  assert(head); \
+  assert(cmp);  \
+  fcl_list_idx bins[FCL_LIST_SORT_BINS] = { FCL_LIST_IDX_NIL }, l, next; \
+  int k, max = 0; \
+  for (l = head->first; l != FCL_LIST_IDX_NIL; l = next) { \
+    next = head->base[l - 1].field.next;  \
+    head->base[l - 1].field.next = FCL_LIST_IDX_NIL;  \
+    for (k = 0; k < FCL_LIST_SORT_BINS - 1 && bins[k]; k++) { \
+      l = _##name##_list_merge(head, bins[k], l, cmp);  \
+      bins[k] = FCL_LIST_IDX_NIL; \
+    } \
+    bins[k] = _##name##_list_merge(head, bins[k], l, cmp); \
+    if (k > max)  \
+      max = k;  \
+  } \
+  for (l = FCL_LIST_IDX_NIL, k = 0; k <= max; k++)  \
+    l = _##name##_list_merge(head, bins[k], l, cmp); \
+  _##name##_list_relink(head, l); \
+} \
+void name##_list_merge_sorted(struct name##_list_head *dst, \
+                              struct name##_list_head *src, \
+                              int (*cmp)(type *a, type *b)) { \
+  assert(dst);  \
+  assert(src);  \
+  assert(cmp);  \
+  assert(dst->base == src->base); \
+  if (name##_list_is_empty(src))  \
+    return; \
+  _##name##_list_relink(dst, _##name##_list_merge(dst, dst->first, \
+                                                  src->first, cmp)); \
+  src->first = src->last = FCL_LIST_IDX_NIL;  \
+}
+
+// functions shared by the singly linked index lists
+#define _FCL_LIST_IDX_SL_DECLARE(name, type) \
+struct name##_list_head { \
+  type *base; \
+  fcl_list_idx first; \
+  fcl_list_idx last;  \
+};  \
+_FCL_LIST_IDX_DECLARE(name, type) \
+void name##_list_insert(struct name##_list_head *head, type *e);  \
+type *name##_list_get(struct name##_list_head *head); \
+type *name##_list_remove(struct name##_list_head *head);  \
+void name##_list_concat(struct name##_list_head *dst, \
+                        struct name##_list_head *src);  \
+void name##_list_splice(struct name##_list_head *dst, \
+                        struct name##_list_head *src);  \
+void name##_list_split_at(struct name##_list_head *head, type *e, \
+                          struct name##_list_head *rest);
+
+#define _FCL_LIST_IDX_SL_DEFINE(name, type, field) \
+_FCL_LIST_IDX_DEFINE(name, type, field) \
+type *name##_list_get(struct name##_list_head *head) { \
+  assert(head); \
+  return name##_list_get_entry(head, head->first);  \
+} \
+type *name##_list_remove(struct name##_list_head *head) { \
+  assert(head); \
+  type *tmp = name##_list_get_entry(head, head->first); \
+  if (tmp)  \
+    head->first = tmp->field.next;  \
+  return tmp; \
+} \
+void name##_list_concat(struct name##_list_head *dst, \
+                        struct name##_list_head *src) { \
+  assert(dst);  \
+  assert(src);  \
+  assert(dst->base == src->base); \
+  if (name##_list_is_empty(src))  \
+    return; \
+  if (! name##_list_is_empty(dst))  \
+    dst->base[dst->last - 1].field.next = src->first; \
+  else  \
+    dst->first = src->first;  \
+  dst->last = src->last;  \
+  src->first = FCL_LIST_IDX_NIL;  \
+} \
+void name##_list_splice(struct name##_list_head *dst, \
+                        struct name##_list_head *src) { \
+  assert(dst);  \
+  assert(src);  \
+  assert(dst->base == src->base); \
+  if (name##_list_is_empty(src))  \
+    return; \
+  if (! name##_list_is_empty(dst))  \
+    src->base[src->last - 1].field.next = dst->first; \
+  else  \
+    dst->last = src->last;  \
+  dst->first = src->first;  \
+  src->first = FCL_LIST_IDX_NIL;  \
+} \
+void name##_list_split_at(struct name##_list_head *head, type *e, \
+                          struct name##_list_head *rest) { \
+  assert(head); \
+  assert(e);  \
+  assert(rest); \
+  assert(head->base == rest->base); \
+  rest->first = e->field.next;  \
+  if (rest->first == FCL_LIST_IDX_NIL)  \
+    return; \
+  rest->last = head->last;  \
+  head->last = name##_list_get_index(head, e);  \
+  e->field.next = FCL_LIST_IDX_NIL; \
+} \
+void _##name##_list_relink(struct name##_list_head *head, \
+                           fcl_list_idx first) { \
+  head->first = first;  \
+  for (; first != FCL_LIST_IDX_NIL; \
+       first = head->base[first - 1].field.next)  \
+    head->last = first; \
+}
+
+
+// name = list prefix, eg events
+// type = container type, eg struct event
+// field = name of the fcl_list_idx_link(s) struct in the container, eg link
+#define FCL_LIST_IDX_FIFO_DECLARE(name, type, field) \
+  _FCL_LIST_IDX_SL_DECLARE(name, type)
+
+#define FCL_LIST_IDX_FIFO_DEFINE(name, type, field) \
+_FCL_LIST_IDX_SL_DEFINE(name, type, field)  \
+void name##_list_insert(struct name##_list_head *head, type *e) { \
+  assert(head); \
+  assert(e);  \
+  fcl_list_idx i = name##_list_get_index(head, e);  \
+  if (! name##_list_is_empty(head)) \
+    head->base[head->last - 1].field.next = i;  \
+  else  \
+    head->first = i;  \
+  head->last = i; \
+  e->field.next = FCL_LIST_IDX_NIL; \
+}
+
+// name = list prefix, eg events
+// type = container type, eg struct event
+// field = name of the fcl_list_idx_link(s) struct in the container, eg link
+#define FCL_LIST_IDX_LIFO_DECLARE(name, type, field) \
+  _FCL_LIST_IDX_SL_DECLARE(name, type)
+
+#define FCL_LIST_IDX_LIFO_DEFINE(name, type, field) \
+_FCL_LIST_IDX_SL_DEFINE(name, type, field)  \
+void name##_list_insert(struct name##_list_head *head, type *e) { \
+  assert(head); \
+  assert(e);  \
+  fcl_list_idx i = name##_list_get_index(head, e);  \
+  if (! name##_list_is_empty(head)) { \
+    e->field.next = head->first;  \
+  } else {  \
+    e->field.next = FCL_LIST_IDX_NIL; \
+    head->last = i; \
+  } \
+  head->first = i;  \
+}
+
+
+// name = list prefix, eg events
+// type = container type, eg struct event
+// field = name of the fcl_list_idx_links struct in the container, eg links
+#define FCL_LIST_IDX_DL_DECLARE(name, type, field) \
+struct name##_list_head { \
+  type *base; \
+  fcl_list_idx first; \
+  fcl_list_idx last;  \
+};  \
+_FCL_LIST_IDX_DECLARE(name, type) \
+void _##name##_list_link(struct name##_list_head *head, type *e, \
+                         fcl_list_idx prev, fcl_list_idx next); \
+void name##_list_insert_head(struct name##_list_head *head, type *e); \
+void name##_list_insert_tail(struct name##_list_head *head, type *e); \
+void name##_list_insert_after(struct name##_list_head *head, type *current, \
+                              type *e); \
+void name##_list_insert_before(struct name##_list_head *head, \
+                               type *current, type *e); \
+void name##_list_remove(struct name##_list_head *head, type *e); \
+type *name##_list_get_first(struct name##_list_head *head); \
+type *name##_list_get_last(struct name##_list_head *head);  \
+type *name##_list_get_prev(struct name##_list_head *head, type *e); \
+void name##_list_concat(struct name##_list_head *dst, \
+                        struct name##_list_head *src);  \
+void name##_list_splice(struct name##_list_head *dst, \
+                        struct name##_list_head *src);  \
+void name##_list_split_at(struct name##_list_head *head, type *e, \
+                          struct name##_list_head *rest);
+
+#define FCL_LIST_IDX_DL_DEFINE(name, type, field) \
+_FCL_LIST_IDX_DEFINE(name, type, field) \
+void _##name##_list_link(struct name##_list_head *head, type *e, \
+                         fcl_list_idx prev, fcl_list_idx next) { \
+  fcl_list_idx i = name##_list_get_index(head, e);  \
+  e->field.prev = prev; \
+  e->field.next = next; \
+  if (prev != FCL_LIST_IDX_NIL) \
+    head->base[prev - 1].field.next = i;  \
+  else  \
+    head->first = i;  \
+  if (next != FCL_LIST_IDX_NIL) \
+    head->base[next - 1].field.prev = i;  \
+  else  \
+    head->last = i; \
+} \
+void name##_list_insert_head(struct name##_list_head *head, type *e) { \
+  assert(head); \
+  assert(e);  \
+  _##name##_list_link(head, e, FCL_LIST_IDX_NIL, head->first);  \
+} \
+void name##_list_insert_tail(struct name##_list_head *head, type *e) { \
+  assert(head); \
+  assert(e);  \
+  _##name##_list_link(head, e, head->last, FCL_LIST_IDX_NIL); \
+} \
+void name##_list_insert_after(struct name##_list_head *head, type *current, \
+                              type *e) { \
+  assert(head); \
+  assert(current);  \
+  assert(e);  \
+  _##name##_list_link(head, e, name##_list_get_index(head, current), \
+                      current->field.next); \
+} \
+void name##_list_insert_before(struct name##_list_head *head, \
+                               type *current, type *e) { \
+  assert(head); \
+  assert(current);  \
+  assert(e);  \
+  _##name##_list_link(head, e, current->field.prev, \
+                      name##_list_get_index(head, current)); \
+} \
+void name##_list_remove(struct name##_list_head *head, type *e) { \
+  assert(head); \
+  assert(e);  \
+  if (e->field.prev != FCL_LIST_IDX_NIL)  \
+    head->base[e->field.prev - 1].field.next = e->field.next; \
+  else  \
+    head->first = e->field.next;  \
+  if (e->field.next != FCL_LIST_IDX_NIL)  \
+    head->base[e->field.next - 1].field.prev = e->field.prev; \
+  else  \
+    head->last = e->field.prev; \
+  e->field.next = e->field.prev = FCL_LIST_IDX_NIL; \
+} \
+type *name##_list_get_first(struct name##_list_head *head) { \
+  assert(head); \
+  return name##_list_get_entry(head, head->first);  \
+} \
+type *name##_list_get_last(struct name##_list_head *head) {  \
+  assert(head); \
+  return name##_list_get_entry(head, head->last); \
+} \
+type *name##_list_get_prev(struct name##_list_head *head, type *e) { \
+  assert(head); \
+  assert(e);  \
+  return name##_list_get_entry(head, e->field.prev);  \
+} \
+void name##_list_concat(struct name##_list_head *dst, \
+                        struct name##_list_head *src) { \
+  assert(dst);  \
+  assert(src);  \
+  assert(dst->base == src->base); \
+  if (name##_list_is_empty(src))  \
+    return; \
+  if (! name##_list_is_empty(dst)) {  \
+    dst->base[dst->last - 1].field.next = src->first; \
+    src->base[src->first - 1].field.prev = dst->last; \
+  } else {  \
+    dst->first = src->first;  \
+  } \
+  dst->last = src->last;  \
+  src->first = src->last = FCL_LIST_IDX_NIL;  \
+} \
+void name##_list_splice(struct name##_list_head *dst, \
+                        struct name##_list_head *src) { \
+  assert(dst);  \
+  assert(src);  \
+  assert(dst->base == src->base); \
+  if (name##_list_is_empty(src))  \
+    return; \
+  if (! name##_list_is_empty(dst)) {  \
+    src->base[src->last - 1].field.next = dst->first; \
+    dst->base[dst->first - 1].field.prev = src->last; \
+  } else {  \
+    dst->last = src->last;  \
+  } \
+  dst->first = src->first;  \
+  src->first = src->last = FCL_LIST_IDX_NIL;  \
+} \
+void name##_list_split_at(struct name##_list_head *head, type *e, \
+                          struct name##_list_head *rest) { \
+  assert(head); \
+  assert(e);  \
+  assert(rest); \
+  assert(head->base == rest->base); \
+  rest->first = rest->last = FCL_LIST_IDX_NIL;  \
+  if (e->field.next == FCL_LIST_IDX_NIL)  \
+    return; \
+  rest->first = e->field.next;  \
+  rest->last = head->last;  \
+  rest->base[rest->first - 1].field.prev = FCL_LIST_IDX_NIL;  \
+  head->last = name##_list_get_index(head, e);  \
+  e->field.next = FCL_LIST_IDX_NIL; \
+} \
+void _##name##_list_relink(struct name##_list_head *head, \
+                           fcl_list_idx first) { \
+  fcl_list_idx prev = FCL_LIST_IDX_NIL; \
+  head->first = first;  \
+  for (; first != FCL_LIST_IDX_NIL; \
+       prev = first, first = head->base[first - 1].field.next)  \
+    head->base[first - 1].field.prev = prev;  \
+  head->last = prev;  \
+}
+
+
+#endif  // _FCL_LIST_IDX_H_
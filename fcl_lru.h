@@ -0,0 +1,190 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only intrusive LRU cache.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Allocation and deallocation of entries are not managed by this library and
+   are the responsibility of the caller, through the eviction callback.
+   This library is NOT thread safe.
+
+   FCL_LRU_XXX macros combine an FCL_LIST_DL recency list with an FCL_HASH
+   index over the same entries.  Each entry embeds an fcl_list_links for the
+   recency list, an fcl_list_link for the hash chain, and its key.  find looks
+   an entry up by key and moves it to the head of the recency list, insert
+   adds an entry at the head, and when the cache holds more than capacity
+   entries the entry at the tail (the least recently used) is removed and
+   passed to the eviction callback.  All of these are O(1) (expected, for the
+   hash lookup).  The callback receives the user supplied context pointer, so
+   an evicted object can be returned straight to its FCL_ALLOCATOR_LL:
+     void evict(struct obj *o, void *ctx) { obj_allocator_return(ctx, o); }
+   A capacity of 0 never evicts.
+
+   FCL_LRU_CLOCK_XXX macros generate the same cache with the CLOCK (second
+   chance) approximation of LRU.  The entry additionally has a reference
+   field, eg an unsigned char.  A hit only sets the reference field instead
+   of relinking the entry, which avoids writing to two neighbouring entries on
+   every hit.  When an entry must be evicted, entries at the tail with the
+   reference set are cleared and moved back to the head until an
+   unreferenced one is found.
+
+   The cache does not check for duplicate keys; find before insert if a key
+   may already be cached.
+*/
+
+#ifndef _FCL_LRU_H_
+#define _FCL_LRU_H_
+
+#include <assert.h>   // assert
+#include <stddef.h>   // offsetof
+#include "fcl_hash.h"
+#include "fcl_list.h"
+#include "fcl_macro.h"
+
+
+// recency policy hooks, selected by mode
+#define _FCL_LRU_LRU_INSERT(name, c, e, ref_field)
+#define _FCL_LRU_LRU_HIT(name, c, e, ref_field) \
+  do {  \
+    name##_lru_order_list_remove(e);  \
+    name##_lru_order_list_insert_head(&(c)->order, e);  \
+  } while (0)
+#define _FCL_LRU_LRU_VICTIM(name, c, e, ref_field) \
+  (e = name##_lru_order_list_get_last(&(c)->order))
+#define _FCL_LRU_CLOCK_INSERT(name, c, e, ref_field) ((e)->ref_field = 0)
+#define _FCL_LRU_CLOCK_HIT(name, c, e, ref_field) ((e)->ref_field = 1)
+#define _FCL_LRU_CLOCK_VICTIM(name, c, e, ref_field) \
+  do {  \
+    while ((e = name##_lru_order_list_get_last(&(c)->order)) && \
+           e->ref_field) {  \
+      e->ref_field = 0; \
+      name##_lru_order_list_remove(e);  \
+      name##_lru_order_list_insert_head(&(c)->order, e);  \
+    } \
+  } while (0)
+
+
+// name = cache prefix, eg objs
+// type = container type, eg struct obj
+// key_type = type of the key field, eg uint64_t
+// links_field = name of the struct fcl_list_links in the container
+// hlink_field = name of the struct fcl_list_link in the container
+// key_field = name of the key in the container, eg id
+// hash_fn = size_t hash_fn(key_type), eg fcl_hash_u64
+// eq_fn = int eq_fn(key_type, key_type), eg FCL_HASH_EQ
+#define FCL_LRU_DECLARE(name, type, key_type, links_field, hlink_field, \
+                        key_field, hash_fn, eq_fn) \
+  _FCL_LRU_DECLARE(name, type, key_type, links_field, hlink_field, \
+                   key_field, hash_fn, eq_fn)
+
+#define FCL_LRU_DEFINE(name, type, key_type, links_field, hlink_field, \
+                       key_field, hash_fn, eq_fn) \
+  _FCL_LRU_DEFINE(name, type, key_type, links_field, hlink_field, \
+                  key_field, hash_fn, eq_fn, LRU, links_field)
+
+// same as FCL_LRU_XXX, with CLOCK replacement
+// ref_field = name of an integer reference field in the container, eg ref
+#define FCL_LRU_CLOCK_DECLARE(name, type, key_type, links_field, hlink_field, \
+                              key_field, hash_fn, eq_fn, ref_field) \
+  _FCL_LRU_DECLARE(name, type, key_type, links_field, hlink_field, \
+                   key_field, hash_fn, eq_fn)
+
+#define FCL_LRU_CLOCK_DEFINE(name, type, key_type, links_field, hlink_field, \
+                             key_field, hash_fn, eq_fn, ref_field) \
+  _FCL_LRU_DEFINE(name, type, key_type, links_field, hlink_field, \
+                  key_field, hash_fn, eq_fn, CLOCK, ref_field)
+
+#define _FCL_LRU_DECLARE(name, type, key_type, links_field, hlink_field, \
+                         key_field, hash_fn, eq_fn) \
+FCL_HASH_DECLARE(name##_lru_index, type, key_type, hlink_field, key_field, \
+                 hash_fn, eq_fn) \
+FCL_LIST_DL_DECLARE(name##_lru_order, type, links_field) \
+typedef void (*name##_lru_evict_fn)(type *e, void *ctx); \
+struct name##_lru { \
+  struct name##_lru_index_hash index; \
+  struct fcl_list_links order;  \
+  size_t capacity;  \
+  name##_lru_evict_fn evict;  \
+  void *evict_ctx;  \
+};  \
+int name##_lru_init(struct name##_lru *c, size_t capacity, \
+                    name##_lru_evict_fn evict, void *evict_ctx); \
+void name##_lru_freeall(struct name##_lru *c); \
+size_t name##_lru_count(struct name##_lru *c); \
+type *name##_lru_find(struct name##_lru *c, key_type key); \
+type *name##_lru_peek(struct name##_lru *c, key_type key); \
+void name##_lru_insert(struct name##_lru *c, type *e); \
+void name##_lru_remove(struct name##_lru *c, type *e); \
+type *name##_lru_remove_coldest(struct name##_lru *c);
+
+#define _FCL_LRU_DEFINE(name, type, key_type, links_field, hlink_field, \
+                        key_field, hash_fn, eq_fn, mode, ref_field) \
+FCL_HASH_DEFINE(name##_lru_index, type, key_type, hlink_field, key_field, \
+                hash_fn, eq_fn) \
+FCL_LIST_DL_DEFINE(name##_lru_order, type, links_field) \
+int name##_lru_init(struct name##_lru *c, size_t capacity, \
+                    name##_lru_evict_fn evict, void *evict_ctx) { \
+  assert(c);  \
+  if (name##_lru_index_hash_init(&c->index, capacity) != 1) \
+    return -1;  \
+  fcl_list_dl_init(&c->order);  \
+  c->capacity = capacity; \
+  c->evict = evict; \
+  c->evict_ctx = evict_ctx; \
+  return 1; \
+} \
+void name##_lru_freeall(struct name##_lru *c) { \
+  assert(c);  \
+  type *e;  \
+  while ((e = name##_lru_remove_coldest(c)))  \
+    if (c->evict) \
+      c->evict(e, c->evict_ctx);  \
+  name##_lru_index_hash_freeall(&c->index); \
+} \
+size_t name##_lru_count(struct name##_lru *c) { \
+  assert(c);  \
+  return name##_lru_index_hash_count(&c->index);  \
+} \
+type *name##_lru_find(struct name##_lru *c, key_type key) { \
+  assert(c);  \
+  type *e = name##_lru_index_hash_find(&c->index, key); \
+  if (e)  \
+    _FCL_LRU_##mode##_HIT(name, c, e, ref_field); \
+  return e; \
+} \
+type *name##_lru_peek(struct name##_lru *c, key_type key) { \
+  assert(c);  \
+  return name##_lru_index_hash_find(&c->index, key); \
+} \
+void name##_lru_insert(struct name##_lru *c, type *e) { \
+  assert(c);  \
+  assert(e);  \
+  type *victim; \
+  _FCL_LRU_##mode##_INSERT(name, c, e, ref_field);  \
+  name##_lru_order_list_insert_head(&c->order, e);  \
+  name##_lru_index_hash_insert(&c->index, e); \
+  if (!c->capacity || name##_lru_count(c) <= c->capacity) \
+    return; \
+  victim = name##_lru_remove_coldest(c);  \
+  if (victim && c->evict) \
+    c->evict(victim, c->evict_ctx); \
+} \
+void name##_lru_remove(struct name##_lru *c, type *e) { \
+  assert(c);  \
+  assert(e);  \
+  name##_lru_order_list_remove(e);  \
+  name##_lru_index_hash_remove(&c->index, e); \
+} \
+type *name##_lru_remove_coldest(struct name##_lru *c) { \
+  assert(c);  \
+  type *e;  \
+  _FCL_LRU_##mode##_VICTIM(name, c, e, ref_field);  \
+  if (e)  \
+    name##_lru_remove(c, e);  \
+  return e; \
+}
+
+
+#endif  // _FCL_LRU_H_
@@ -8,6 +8,16 @@
 #ifndef _FCL_MACRO_H_
 #define _FCL_MACRO_H_
 
+#ifndef LEVEL1_DCACHE_LINESIZE
+/*! Used to align and place objects to avoid false sharing
+
+  On modern Intel x86 CPUs, this is typically 64 bytes
+  On Linux it can be defined while compiling with
+  \verbatim -DLEVEL1_DCACHE_LINESIZE=`getconf LEVEL1_DCACHE_LINESIZE` \endverbatim
+*/
+#define LEVEL1_DCACHE_LINESIZE 64
+#endif
+
 // returns a pointer to a container of type @type given the pointer @ptr which
 // is the field @field in the container
 // ex: ptr = &container.field, and this returns &container
@@ -24,5 +34,25 @@
   ((void*)((char*)(ptr) + (offset)))
 #endif
 
+// hints that the cache line at @ptr will be read soon; never faults
+#ifndef FCL_PREFETCH
+#if defined(__GNUC__)
+#define FCL_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define FCL_PREFETCH(ptr) ((void)(ptr))
+#endif
+#endif
+
+// branch hints for the compiler's block layout
+#ifndef FCL_LIKELY
+#if defined(__GNUC__)
+#define FCL_LIKELY(x) __builtin_expect(!!(x), 1)
+#define FCL_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define FCL_LIKELY(x) (x)
+#define FCL_UNLIKELY(x) (x)
+#endif
+#endif
+
 #endif  // _FCL_MACRO_H_
 
@@ -0,0 +1,335 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only library of bounded ring buffer queues.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Requires C11 atomics.
+
+   The rings hold pointers to the caller's objects, typically borrowed from
+   an FCL_ALLOCATOR_LL, so a handoff between pipeline stages copies one
+   pointer and never the object.  name##_ring_xxx_init rounds the capacity
+   up to a power of 2 and allocates the ring once; enqueue returns -1 when
+   the ring is full and dequeue returns NULL when it is empty, so the caller
+   decides whether to spin, yield or drop.  The bulk variants move up to n
+   pointers and return how many were moved, which may be 0.
+
+   FCL_RING_SPSC_XXX macros generate a queue for exactly one producer thread
+   and one consumer thread.  The producer's tail and the consumer's head are
+   on separate cache lines, and each side keeps a private copy of the other
+   side's index next to its own.  The copy is only refreshed when the ring
+   looks full (or empty) through it, so in the steady state each side
+   touches the shared line of the other at most once per lap rather than
+   once per operation.  A bulk operation publishes its whole batch with one
+   store.
+
+   FCL_RING_MPMC_XXX macros generate a queue for any number of producers and
+   consumers, after Dmitry Vyukov's bounded MPMC queue.  Every slot carries a
+   sequence number that says whether it is free or full for the current lap,
+   so a producer (consumer) only needs a CAS on the enqueue (dequeue)
+   position, and producers never read the dequeue position or the other way
+   around; there is no opposite index to cache.  The two positions are on
+   separate cache lines.  A bulk operation claims a run of consecutive ready
+   slots with a single CAS.  A producer that has claimed a slot but not yet
+   filled it holds up the consumers behind it: they see the ring as empty
+   (or a short batch) until it is filled, so a preempted producer delays,
+   but never corrupts, the queue.
+*/
+
+#ifndef _FCL_RING_H_
+#define _FCL_RING_H_
+
+#include <assert.h>     // assert
+#include <stdint.h>     // intptr_t
+#include <stdlib.h>     // calloc
+#include <stdatomic.h>  // atomic_load_explicit
+#include "fcl_macro.h"
+
+#define FCL_RING_DEFAULT_CAPACITY 1024
+
+#define _FCL_RING_CAPACITY(capacity, n) \
+  do {  \
+    n = 1;  \
+    if (!capacity)  \
+      capacity = FCL_RING_DEFAULT_CAPACITY; \
+    while (n < capacity)  \
+      n <<= 1;  \
+  } while (0)
+
+
+// name = ring prefix, eg msgs
+// type = object type, eg struct msg
+#define FCL_RING_SPSC_DECLARE(name, type) \
+struct name##_ring_spsc { \
+  _Alignas(LEVEL1_DCACHE_LINESIZE) atomic_size_t head;  \
+  size_t tail_cache;  \
+  _Alignas(LEVEL1_DCACHE_LINESIZE) atomic_size_t tail;  \
+  size_t head_cache;  \
+  _Alignas(LEVEL1_DCACHE_LINESIZE) type **buf;  \
+  size_t mask;  \
+};  \
+int name##_ring_spsc_init(struct name##_ring_spsc *q, size_t capacity); \
+void name##_ring_spsc_freeall(struct name##_ring_spsc *q); \
+size_t name##_ring_spsc_size(struct name##_ring_spsc *q); \
+int name##_ring_spsc_enqueue(struct name##_ring_spsc *q, type *e); \
+type *name##_ring_spsc_dequeue(struct name##_ring_spsc *q); \
+size_t name##_ring_spsc_enqueue_bulk(struct name##_ring_spsc *q, \
+                                     type *const *e, size_t n); \
+size_t name##_ring_spsc_dequeue_bulk(struct name##_ring_spsc *q, type **e, \
+                                     size_t n);
+
+#define FCL_RING_SPSC_DEFINE(name, type) \
+int name##_ring_spsc_init(struct name##_ring_spsc *q, size_t capacity) { \
+  assert(q);  \
+  size_t n; \
+  _FCL_RING_CAPACITY(capacity, n);  \
+  q->buf = calloc(n, sizeof(*q->buf));  \
+  if (!q->buf)  \
+    return -1;  \
+  q->mask = n - 1;  \
+  atomic_init(&q->head, 0); \
+  atomic_init(&q->tail, 0); \
+  q->tail_cache = 0;  \
+  q->head_cache = 0;  \
+  return 1; \
+} \
+void name##_ring_spsc_freeall(struct name##_ring_spsc *q) { \
+  assert(q);  \
+  free(q->buf); \
+  q->buf = NULL;  \
+  q->mask = 0;  \
+} \
+size_t name##_ring_spsc_size(struct name##_ring_spsc *q) { \
+  assert(q);  \
+  return atomic_load_explicit(&q->tail, memory_order_acquire) - \
+         atomic_load_explicit(&q->head, memory_order_acquire);  \
+} \
+int name##_ring_spsc_enqueue(struct name##_ring_spsc *q, type *e) { \
+  assert(q);  \
+  size_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);  \
+  if (t - q->head_cache > q->mask) {  \
+    q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire); \
+    if (t - q->head_cache > q->mask)  \
+      return -1;  \
+  } \
+  q->buf[t & q->mask] = e;  \
+  atomic_store_explicit(&q->tail, t + 1, memory_order_release); \
+  return 1; \
+} \
+type *name##_ring_spsc_dequeue(struct name##_ring_spsc *q) { \
+  assert(q);  \
+  size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);  \
+  type *e;  \
+  if (h == q->tail_cache) { \
+    q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire); \
+    if (h == q->tail_cache) \
+      return NULL;  \
+  } \
+  e = q->buf[h & q->mask];  \
+  atomic_store_explicit(&q->head, h + 1, memory_order_release); \
+  return e; \
+} \
+size_t name##_ring_spsc_enqueue_bulk(struct name##_ring_spsc *q, \
+                                     type *const *e, size_t n) { \
+  assert(q);  \
+  assert(e || !n);  \
+  size_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);  \
+  size_t i, space = q->mask + 1 - (t - q->head_cache);  \
+  if (space < n) {  \
+    q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire); \
+    space = q->mask + 1 - (t - q->head_cache);  \
+    if (space < n)  \
+      n = space;  \
+  } \
+  for (i=0; i < n; i++) \
+    q->buf[(t + i) & q->mask] = e[i]; \
+  atomic_store_explicit(&q->tail, t + n, memory_order_release); \
+  return n; \
+} \
+size_t name##_ring_spsc_dequeue_bulk(struct name##_ring_spsc *q, type **e, \
+                                     size_t n) { \
+  assert(q);  \
+  assert(e || !n);  \
+  size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);  \
+  size_t i, avail = q->tail_cache - h;  \
+  if (avail < n) {  \
+    q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire); \
+    avail = q->tail_cache - h;  \
+    if (avail < n)  \
+      n = avail;  \
+  } \
+  for (i=0; i < n; i++) \
+    e[i] = q->buf[(h + i) & q->mask]; \
+  atomic_store_explicit(&q->head, h + n, memory_order_release); \
+  return n; \
+}
+
+
+// name = ring prefix, eg msgs
+// type = object type, eg struct msg
+#define FCL_RING_MPMC_DECLARE(name, type) \
+struct name##_ring_mpmc_cell {  \
+  atomic_size_t seq;  \
+  type *data; \
+};  \
+struct name##_ring_mpmc { \
+  _Alignas(LEVEL1_DCACHE_LINESIZE) atomic_size_t enqueue_pos; \
+  _Alignas(LEVEL1_DCACHE_LINESIZE) atomic_size_t dequeue_pos; \
+  _Alignas(LEVEL1_DCACHE_LINESIZE) struct name##_ring_mpmc_cell *cells; \
+  size_t mask;  \
+};  \
+int name##_ring_mpmc_init(struct name##_ring_mpmc *q, size_t capacity); \
+void name##_ring_mpmc_freeall(struct name##_ring_mpmc *q); \
+size_t name##_ring_mpmc_size(struct name##_ring_mpmc *q); \
+int name##_ring_mpmc_enqueue(struct name##_ring_mpmc *q, type *e); \
+type *name##_ring_mpmc_dequeue(struct name##_ring_mpmc *q); \
+size_t name##_ring_mpmc_enqueue_bulk(struct name##_ring_mpmc *q, \
+                                     type *const *e, size_t n); \
+size_t name##_ring_mpmc_dequeue_bulk(struct name##_ring_mpmc *q, type **e, \
+                                     size_t n);
+
+#define FCL_RING_MPMC_DEFINE(name, type) \
+int name##_ring_mpmc_init(struct name##_ring_mpmc *q, size_t capacity) { \
+  assert(q);  \
+  size_t i, n;  \
+  _FCL_RING_CAPACITY(capacity, n);  \
+  q->cells = calloc(n, sizeof(*q->cells));  \
+  if (!q->cells)  \
+    return -1;  \
+  for (i=0; i < n; i++) \
+    atomic_init(&q->cells[i].seq, i); \
+  q->mask = n - 1;  \
+  atomic_init(&q->enqueue_pos, 0);  \
+  atomic_init(&q->dequeue_pos, 0);  \
+  return 1; \
+} \
+void name##_ring_mpmc_freeall(struct name##_ring_mpmc *q) { \
+  assert(q);  \
+  free(q->cells); \
+  q->cells = NULL;  \
+  q->mask = 0;  \
+} \
+size_t name##_ring_mpmc_size(struct name##_ring_mpmc *q) { \
+  assert(q);  \
+  size_t t = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed); \
+  size_t h = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed); \
+  return t > h ? t - h : 0; \
+} \
+int name##_ring_mpmc_enqueue(struct name##_ring_mpmc *q, type *e) { \
+  assert(q);  \
+  struct name##_ring_mpmc_cell *c;  \
+  size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed); \
+  intptr_t diff;  \
+  for (;;) {  \
+    c = &q->cells[pos & q->mask]; \
+    diff = (intptr_t)atomic_load_explicit(&c->seq, memory_order_acquire) - \
+           (intptr_t)pos; \
+    if (!diff) {  \
+      if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos, \
+                                                pos + 1, \
+                                                memory_order_relaxed, \
+                                                memory_order_relaxed))  \
+        break;  \
+    } else if (diff < 0) {  \
+      return -1;  \
+    } else {  \
+      pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed); \
+    } \
+  } \
+  c->data = e;  \
+  atomic_store_explicit(&c->seq, pos + 1, memory_order_release);  \
+  return 1; \
+} \
+type *name##_ring_mpmc_dequeue(struct name##_ring_mpmc *q) { \
+  assert(q);  \
+  struct name##_ring_mpmc_cell *c;  \
+  size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed); \
+  intptr_t diff;  \
+  type *e;  \
+  for (;;) {  \
+    c = &q->cells[pos & q->mask]; \
+    diff = (intptr_t)atomic_load_explicit(&c->seq, memory_order_acquire) - \
+           (intptr_t)(pos + 1); \
+    if (!diff) {  \
+      if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos, \
+                                                pos + 1, \
+                                                memory_order_relaxed, \
+                                                memory_order_relaxed))  \
+        break;  \
+    } else if (diff < 0) {  \
+      return NULL;  \
+    } else {  \
+      pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed); \
+    } \
+  } \
+  e = c->data;  \
+  atomic_store_explicit(&c->seq, pos + q->mask + 1, memory_order_release); \
+  return e; \
+} \
+size_t name##_ring_mpmc_enqueue_bulk(struct name##_ring_mpmc *q, \
+                                     type *const *e, size_t n) { \
+  assert(q);  \
+  assert(e || !n);  \
+  size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed); \
+  size_t i, k, seq = 0; \
+  for (;;) {  \
+    for (k=0; k < n; k++) { \
+      seq = atomic_load_explicit(&q->cells[(pos + k) & q->mask].seq, \
+                                 memory_order_acquire); \
+      if (seq != pos + k) \
+        break;  \
+    } \
+    if (!k) { \
+      if (!n || (intptr_t)seq - (intptr_t)pos < 0)  \
+        return 0; \
+      pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed); \
+    } else if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos, \
+                                                     pos + k, \
+                                                     memory_order_relaxed, \
+                                                     memory_order_relaxed)) { \
+      break;  \
+    } \
+  } \
+  for (i=0; i < k; i++) { \
+    q->cells[(pos + i) & q->mask].data = e[i];  \
+    atomic_store_explicit(&q->cells[(pos + i) & q->mask].seq, pos + i + 1, \
+                          memory_order_release);  \
+  } \
+  return k; \
+} \
+size_t name##_ring_mpmc_dequeue_bulk(struct name##_ring_mpmc *q, type **e, \
+                                     size_t n) { \
+  assert(q);  \
+  assert(e || !n);  \
+  size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed); \
+  size_t i, k, seq = 0; \
+  for (;;) {  \
+    for (k=0; k < n; k++) { \
+      seq = atomic_load_explicit(&q->cells[(pos + k) & q->mask].seq, \
+                                 memory_order_acquire); \
+      if (seq != pos + k + 1) \
+        break;  \
+    } \
+    if (!k) { \
+      if (!n || (intptr_t)seq - (intptr_t)(pos + 1) < 0)  \
+        return 0; \
+      pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed); \
+    } else if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos, \
+                                                     pos + k, \
+                                                     memory_order_relaxed, \
+                                                     memory_order_relaxed)) { \
+      break;  \
+    } \
+  } \
+  for (i=0; i < k; i++) { \
+    e[i] = q->cells[(pos + i) & q->mask].data;  \
+    atomic_store_explicit(&q->cells[(pos + i) & q->mask].seq, \
+                          pos + i + q->mask + 1, memory_order_release); \
+  } \
+  return k; \
+}
+
+
+#endif  // _FCL_RING_H_
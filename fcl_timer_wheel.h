@@ -0,0 +1,152 @@
+/*!
+  \file
+  \copyright Copyright (c) 2015, Richard Fujiyama
+  Licensed under the terms of the New BSD license.
+*/
+
+/* A header-only hierarchical timer wheel.
+   Typesafety is provided by generating type-specific functions via a macro.
+   Allocation and deallocation of timers are not managed by this library and
+   are the responsibility of the caller, eg via FCL_ALLOCATOR_LL.
+   This library is NOT thread safe.
+
+   The fcl_list_links struct, together with FCL_TIMER_WHEEL_XXX macros
+   implement a timer wheel with FCL_TIMER_WHEEL_LEVELS levels of
+   FCL_TIMER_WHEEL_SLOTS slots each.  Every slot is an fcl_list_links sentinel
+   of an FCL_LIST_DL list, and every timer embeds an fcl_list_links and a
+   uint64_t expiry time in ticks.  A timer due within FCL_TIMER_WHEEL_SLOTS
+   ticks sits in the level 0 slot of its expiry tick; a timer due later sits
+   in a coarser level, each slot of which spans all the slots of the level
+   below.  Arm and cancel are an O(1) list insert and remove and never
+   allocate.
+
+   Advancing the wheel visits every tick up to the new time.  Whenever the
+   level 0 index wraps, the due slot of the next level is cascaded: its timers
+   are placed again, now in finer slots.  The level 0 slot of each tick is
+   then concatenated onto the caller's expired list in O(1), so the caller
+   receives one list of every expired timer and walks it with
+   FCL_LIST_DL_EACH.  An expired timer fires on exactly its expiry tick.
+   When no timers are armed, advance jumps straight to the new time.
+
+   A timer armed at or before the current time expires on the next tick.
+   A timer due beyond the range of the wheel is kept in the top level and
+   placed again each time its slot comes around.
+*/
+
+#ifndef _FCL_TIMER_WHEEL_H_
+#define _FCL_TIMER_WHEEL_H_
+
+#include <assert.h>   // assert
+#include <stdint.h>   // uint64_t
+#include "fcl_list.h"
+
+#define FCL_TIMER_WHEEL_LEVELS 4
+#define FCL_TIMER_WHEEL_BITS 8
+#define FCL_TIMER_WHEEL_SLOTS (1 << FCL_TIMER_WHEEL_BITS)
+#define FCL_TIMER_WHEEL_MASK (FCL_TIMER_WHEEL_SLOTS - 1)
+
+
+// name = timer wheel prefix, eg conn_timeouts
+// type = container type, eg struct conn
+// field = name of the fcl_list_links struct in the container, eg tlinks
+// expires_field = name of the uint64_t expiry tick in the container
+#define FCL_TIMER_WHEEL_DECLARE(name, type, field, expires_field) \
+FCL_LIST_DL_DECLARE(name##_timer, type, field)  \
+struct name##_timer_wheel { \
+  uint64_t now; \
+  size_t count; \
+  struct fcl_list_links \
+      slots[FCL_TIMER_WHEEL_LEVELS][FCL_TIMER_WHEEL_SLOTS];  \
+};  \
+void name##_timer_wheel_init(struct name##_timer_wheel *w, uint64_t now); \
+size_t name##_timer_wheel_count(struct name##_timer_wheel *w); \
+void _##name##_timer_wheel_place(struct name##_timer_wheel *w, type *e); \
+void _##name##_timer_wheel_cascade(struct name##_timer_wheel *w); \
+void name##_timer_wheel_arm(struct name##_timer_wheel *w, type *e, \
+                            uint64_t expires);  \
+void name##_timer_wheel_cancel(struct name##_timer_wheel *w, type *e); \
+size_t name##_timer_wheel_advance(struct name##_timer_wheel *w, \
+                                  uint64_t now, \
+                                  struct fcl_list_links *expired);
+
+#define FCL_TIMER_WHEEL_DEFINE(name, type, field, expires_field) \
+FCL_LIST_DL_DEFINE(name##_timer, type, field) \
+void name##_timer_wheel_init(struct name##_timer_wheel *w, uint64_t now) { \
+  assert(w);  \
+  int l, i; \
+  w->now = now; \
+  w->count = 0; \
+  for (l=0; l < FCL_TIMER_WHEEL_LEVELS; l++)  \
+    for (i=0; i < FCL_TIMER_WHEEL_SLOTS; i++) \
+      fcl_list_dl_init(&w->slots[l][i]);  \
+} \
+size_t name##_timer_wheel_count(struct name##_timer_wheel *w) { \
+  assert(w);  \
+  return w->count;  \
+} \
+void _##name##_timer_wheel_place(struct name##_timer_wheel *w, type *e) { \
+  uint64_t delta = e->expires_field - w->now, pos = e->expires_field; \
+  int l, shift; \
+  for (l=0; l < FCL_TIMER_WHEEL_LEVELS - 1; l++) \
+    if (delta < (uint64_t)1 << (FCL_TIMER_WHEEL_BITS * (l + 1)))  \
+      break;  \
+  shift = FCL_TIMER_WHEEL_BITS * l; \
+  if (delta >> shift >= FCL_TIMER_WHEEL_SLOTS)  \
+    pos = w->now + ((uint64_t)FCL_TIMER_WHEEL_MASK << shift); \
+  name##_timer_list_insert_tail( \
+      &w->slots[l][(pos >> shift) & FCL_TIMER_WHEEL_MASK], e);  \
+} \
+void _##name##_timer_wheel_cascade(struct name##_timer_wheel *w) { \
+  struct fcl_list_links due, *i, *tmp;  \
+  int l, idx, shift;  \
+  for (l=1; l < FCL_TIMER_WHEEL_LEVELS; l++) {  \
+    shift = FCL_TIMER_WHEEL_BITS * l; \
+    if (w->now & (((uint64_t)1 << shift) - 1))  \
+      break;  \
+    idx = (w->now >> shift) & FCL_TIMER_WHEEL_MASK; \
+    fcl_list_dl_init(&due); \
+    name##_timer_list_move_all(&due, &w->slots[l][idx]); \
+    FCL_LIST_DL_EACH(&due, i, tmp)  \
+      _##name##_timer_wheel_place(w, name##_timer_list_get_entry(i)); \
+  } \
+} \
+void name##_timer_wheel_arm(struct name##_timer_wheel *w, type *e, \
+                            uint64_t expires) { \
+  assert(w);  \
+  assert(e);  \
+  e->expires_field = expires > w->now ? expires : w->now + 1; \
+  _##name##_timer_wheel_place(w, e);  \
+  w->count++; \
+} \
+void name##_timer_wheel_cancel(struct name##_timer_wheel *w, type *e) { \
+  assert(w);  \
+  assert(e);  \
+  name##_timer_list_remove(e);  \
+  w->count--; \
+} \
+size_t name##_timer_wheel_advance(struct name##_timer_wheel *w, \
+                                  uint64_t now, \
+                                  struct fcl_list_links *expired) { \
+  assert(w);  \
+  assert(expired);  \
+  struct fcl_list_links *slot, *i; \
+  size_t k, n = 0;  \
+  while (w->now < now) {  \
+    if (!w->count) {  \
+      w->now = now; \
+      break;  \
+    } \
+    w->now++; \
+    _##name##_timer_wheel_cascade(w); \
+    slot = &w->slots[0][w->now & FCL_TIMER_WHEEL_MASK]; \
+    for (i = slot->next, k = 0; i != slot; i = i->next) \
+      k++;  \
+    w->count -= k;  \
+    n += k; \
+    name##_timer_list_concat(expired, slot);  \
+  } \
+  return n; \
+}
+
+
+#endif  // _FCL_TIMER_WHEEL_H_